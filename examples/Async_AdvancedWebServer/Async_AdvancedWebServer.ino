@@ -226,7 +226,12 @@ void drawGraph(AsyncWebServerRequest *request)
   }
   out += "</g>\n</svg>\n";
 
-  request->send(200, "image/svg+xml", out);
+  AsyncWebServerResponse *response = request->beginResponse(200, "image/svg+xml", out);
+
+  // Drawn at most once per second, the requests in between being answered from the response cache
+  response->setCacheable(1000);
+
+  request->send(response);
 }
 
 
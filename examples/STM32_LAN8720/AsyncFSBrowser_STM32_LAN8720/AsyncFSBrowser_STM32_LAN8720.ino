@@ -325,7 +325,7 @@ void setup()
     }
 
     request->send(404);
-  });
+  }).setInterestingHeaders(HEADER_MASK_ANY);   // lists all the headers
    
   server.onRequestBody([](AsyncWebServerRequest * request, uint8_t *data, size_t len, size_t index, size_t total) 
   {
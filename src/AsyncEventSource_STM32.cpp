@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -32,7 +32,9 @@
   1.4.1   K Hoang      12/01/2022 Fix authenticate issue caused by libb64
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
-  1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks *****************************************************************************************************************************/
+  1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
+ *****************************************************************************************************************************/
 
 #if !defined(_ASYNCWEBSERVER_STM32_LOGLEVEL_)
   #define _ASYNCWEBSERVER_STM32_LOGLEVEL_     1
@@ -246,8 +248,8 @@ AsyncEventSourceClient::AsyncEventSourceClient(AsyncWebServerRequest *request, A
   _server = server;
   _lastId = 0;
 
-  if (request->hasHeader("Last-Event-ID"))
-    _lastId = atoi(request->getHeader("Last-Event-ID")->value().c_str());
+  if (request->hasHeader(HEADER_LAST_EVENT_ID))
+    _lastId = atoi(request->header(HEADER_LAST_EVENT_ID).c_str());
 
   _client->setRxTimeout(0);
   _client->onError(NULL, NULL);
@@ -407,7 +409,11 @@ AsyncEventSource::AsyncEventSource(const String& url)
   delete c;
 }))
 , _connectcb(NULL)
-{}
+{
+  setInterestingHeaders(webHeaderMask(HEADER_LAST_EVENT_ID));
+  setMethodMask(HTTP_GET);
+  setPathPrefix(_url.c_str());
+}
 
 /////////////////////////////////////////////////////////
 
@@ -509,8 +515,6 @@ bool AsyncEventSource::canHandle(AsyncWebServerRequest *request)
     return false;
   }
 
-  request->addInterestingHeader("Last-Event-ID");
-
   return true;
 }
 
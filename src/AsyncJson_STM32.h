@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 /*
   Async Response to use with ArduinoJson and AsyncWebServer
@@ -363,8 +364,6 @@ class AsyncCallbackJsonWebHandler: public AsyncWebHandler
       if ( !request->contentType().equalsIgnoreCase(JSON_MIMETYPE) )
         return false;
 
-      request->addInterestingHeader("ANY");
-
       return true;
     }
 
@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #pragma once
@@ -87,6 +88,54 @@ class AsyncStaticWebHandler: public AsyncWebHandler
     }
 };
 
+/////////////////////////////////////////////////
+
+// Serves the files of a ROM filesystem generated by utils/romfs_gen.py, which STM32 has instead of a FS
+class AsyncRomWebHandler: public AsyncWebHandler
+{
+  protected:
+    String _uri;
+    AsyncWebRomFS _fs;
+    String _cacheControl;
+    String _lastModified;
+    String _defaultFile;
+
+    const AsyncWebRomFile* _find(AsyncWebServerRequest *request) const;
+
+  public:
+    AsyncRomWebHandler(const char* uri, const AsyncWebRomFS& fs, const char* cache_control);
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+
+    /////////////////////////////////////////////////
+
+    AsyncRomWebHandler& setCacheControl(const char* cache_control)
+    {
+      _cacheControl = cache_control;
+      return *this;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Last-Modified of all the files, e.g. the build time. Files are revalidated with their ETag anyway
+    AsyncRomWebHandler& setLastModified(const char* last_modified)
+    {
+      _lastModified = last_modified;
+      return *this;
+    }
+
+    /////////////////////////////////////////////////
+
+    // File served for urls ending with '/', "index.htm" by default
+    AsyncRomWebHandler& setDefaultFile(const char* filename)
+    {
+      _defaultFile = filename;
+      return *this;
+    }
+};
+
+/////////////////////////////////////////////////
+
 class AsyncCallbackWebHandler: public AsyncWebHandler
 {
   private:
@@ -96,18 +145,42 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
     ArRequestHandlerFunction _onRequest;
     ArUploadHandlerFunction _onUpload;
     ArBodyHandlerFunction _onBody;
+    ArBodyStreamHandlerFunction _onBodyStream;
     bool _isRegex;
+    bool _isTemplate;
+
+#ifdef ASYNCWEBSERVER_REGEX
+    // Compiled once in setUri()
+    std::regex _pattern;
+#endif
 
   public:
     AsyncCallbackWebHandler() : _uri(), _method(HTTP_ANY), _onRequest(NULL), _onUpload(NULL), _onBody(NULL),
-      _isRegex(false) {}
+      _onBodyStream(NULL), _isRegex(false), _isTemplate(false) {}
 
     /////////////////////////////////////////////////
 
-    inline void setUri(const String& uri)
+    // A "{name}" segment of uri matches any non empty url segment, added as path param
+    static inline bool isParamSegment(const char* segment, size_t len)
     {
-      _uri = uri;
-      _isRegex = uri.startsWith("^") && uri.endsWith("$");
+      return (len >= 2 && segment[0] == '{' && segment[len - 1] == '}');
+    }
+
+    /////////////////////////////////////////////////
+
+    void setUri(const String& uri);
+
+    /////////////////////////////////////////////////
+
+    // Match the url against a "/sensor/{id}/value" uri segment by segment, adding the path params if addParams
+    static bool matchTemplate(const char* uri, AsyncWebServerRequest *request, bool addParams);
+
+    /////////////////////////////////////////////////
+
+    // true if the uri has "{name}" segments, matching the url segment by segment
+    inline bool isTemplate() const
+    {
+      return _isTemplate;
     }
 
     /////////////////////////////////////////////////
@@ -115,6 +188,14 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
     inline void setMethod(WebRequestMethodComposite method)
     {
       _method = method;
+      setMethodMask(method);
+    }
+
+    /////////////////////////////////////////////////
+
+    inline WebRequestMethodComposite method() const
+    {
+      return _method;
     }
 
     /////////////////////////////////////////////////
@@ -140,6 +221,14 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
 
     /////////////////////////////////////////////////
 
+    // Body callback returning the number of bytes it consumed, used instead of onBody() when set
+    inline void onBodyStream(ArBodyStreamHandlerFunction fn)
+    {
+      _onBodyStream = fn;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual bool canHandle(AsyncWebServerRequest *request) override final
     {
       if (!_onRequest)
@@ -152,16 +241,14 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
 
       if (_isRegex)
       {
-        std::regex pattern(_uri.c_str());
-        std::smatch matches;
-        std::string s(request->url().c_str());
+        std::cmatch matches;
 
-        if (std::regex_search(s, matches, pattern))
+        if (std::regex_search(request->url().c_str(), matches, _pattern))
         {
           for (size_t i = 1; i < matches.size(); ++i)
           {
             // start from 1
-            request->_addPathParam(matches[i].str().c_str());
+            request->_addPathParam(matches.position(i), matches.length(i));
           }
         }
         else
@@ -171,7 +258,14 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
       }
       else
 #endif
-        if (_uri.length() && _uri.endsWith("*"))
+        if (_isTemplate)
+        {
+          if (!matchTemplate(_uri.c_str(), request, false))
+            return false;
+
+          matchTemplate(_uri.c_str(), request, true);
+        }
+        else if (_uri.length() && _uri.endsWith("*"))
         {
           String uriTemplate = String(_uri);
           uriTemplate = uriTemplate.substring(0, uriTemplate.length() - 1);
@@ -182,8 +276,6 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
         else if (_uri.length() && (_uri != request->url() && !request->url().startsWith(_uri + "/")))
           return false;
 
-      request->addInterestingHeader("ANY");
-
       return true;
     }
 
@@ -199,6 +291,15 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
 
     /////////////////////////////////////////////////
 
+    virtual void handleUpload(AsyncWebServerRequest *request, const String& filename __attribute__((unused)),
+                              size_t index, uint8_t *data, size_t len, bool final) override final
+    {
+      if (_onUpload)
+        _onUpload(request, index, data, len, final);
+    }
+
+    /////////////////////////////////////////////////
+
     virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index,
                             size_t total) override final
     {
@@ -208,10 +309,54 @@ class AsyncCallbackWebHandler: public AsyncWebHandler
 
     /////////////////////////////////////////////////
 
+    virtual size_t handleBodyStream(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index,
+                                    size_t total) override final
+    {
+      if (_onBodyStream)
+        return _onBodyStream(request, data, len, index, total);
+
+      handleBody(request, data, len, index, total);
+
+      return len;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual bool isRequestHandlerTrivial() override final
     {
       return _onRequest ? false : true;
     }
 };
 
+/////////////////////////////////////////////////
+
+// Routes of a constexpr AsyncWebRoute table, used straight from flash. One handler takes the whole table
+class AsyncRouteTableWebHandler: public AsyncWebHandler
+{
+  protected:
+    const AsyncWebRoute* _routes;
+    size_t _count;
+    uint8_t* _templates;      // bit i set if the path of route i has "{name}" segments
+
+    inline bool _isTemplate(size_t i) const
+    {
+      return _templates && (_templates[i / 8] & (1 << (i % 8)));
+    }
+
+    const AsyncWebRoute* _find(AsyncWebServerRequest *request) const;
+
+  public:
+    AsyncRouteTableWebHandler(const AsyncWebRoute* routes, size_t count);
+    virtual ~AsyncRouteTableWebHandler();
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+
+    /////////////////////////////////////////////////
+
+    virtual bool isRequestHandlerTrivial() override final
+    {
+      return false;
+    }
+};
+
 #endif /* ASYNCWEBSERVERHANDLERIMPL_STM32_H_ */
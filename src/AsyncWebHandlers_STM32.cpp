@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #if !defined(_ASYNCWEBSERVER_STM32_LOGLEVEL_)
@@ -49,6 +50,8 @@
 AsyncStaticWebHandler::AsyncStaticWebHandler(const char* uri, /*FS& fs,*/ const char* path, const char* cache_control)
   : _uri(uri), _path(path), _cache_control(cache_control), _last_modified(""), _callback(nullptr)
 {
+  setMethodMask(HTTP_GET);
+
   // Ensure leading '/'
   if (_uri.length() == 0 || _uri[0] != '/')
     _uri = "/" + _uri;
@@ -162,3 +165,351 @@ uint8_t AsyncStaticWebHandler::_countBits(const uint8_t value) const
 
   return n;
 }
+
+/////////////////////////////////////////////////
+
+// Compare the path of file to path of len chars, like strcmp()
+static int romPathCompare(const AsyncWebRomFile& file, const char* path, size_t len)
+{
+  int cmp = strncmp(file.path, path, len);
+
+  // Same first len chars, a longer path sorts after
+  if (cmp == 0 && file.path[len] != 0)
+    cmp = 1;
+
+  return cmp;
+}
+
+/////////////////////////////////////////////////
+
+// Binary search of the first variant, the generator sorts the files by path
+const AsyncWebRomFile* AsyncWebRomFS::find(const char* path, size_t len) const
+{
+  size_t low = 0;
+  size_t high = count;
+
+  while (low < high)
+  {
+    const size_t mid = (low + high) / 2;
+
+    if (romPathCompare(files[mid], path, len) < 0)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  if (low < count && romPathCompare(files[low], path, len) == 0)
+    return &files[low];
+
+  return NULL;
+}
+
+/////////////////////////////////////////////////
+
+const AsyncWebRomFile* AsyncWebRomFS::find(const char* path, size_t len, bool gzip) const
+{
+  const AsyncWebRomFile* file = find(path, len);
+
+  // Plain variant found, the gzipped one follows if there is one
+  if (file != NULL && gzip && !file->gzip && file + 1 < files + count && (file + 1)->gzip
+      && romPathCompare(file[1], path, len) == 0)
+  {
+    return file + 1;
+  }
+
+  return file;
+}
+
+/////////////////////////////////////////////////
+
+// true if an Accept-Encoding header value accepts gzip, "gzip;q=0" refusing it
+static bool acceptsGzip(const char* value)
+{
+  if (value == NULL)
+    return false;
+
+  while (*value)
+  {
+    while (*value == ' ' || *value == ',')
+      value++;
+
+    const char* end = value + strcspn(value, ",");
+    const char* params = (const char*) memchr(value, ';', end - value);
+    const char* name = value;
+    size_t len = (params ? params : end) - value;
+
+    while (len && name[len - 1] == ' ')
+      len--;
+
+    value = end;
+
+    if (len != 4 || strncasecmp(name, "gzip", 4))
+      continue;
+
+    if (params == NULL)
+      return true;
+
+    const char* q = strstr(params, "q=");
+
+    return (q == NULL || q >= end || strtod(q + 2, NULL) > 0);
+  }
+
+  return false;
+}
+
+/////////////////////////////////////////////////
+
+AsyncRomWebHandler::AsyncRomWebHandler(const char* uri, const AsyncWebRomFS& fs, const char* cache_control)
+  : _uri(uri), _fs(fs), _cacheControl(cache_control), _defaultFile("index.htm")
+{
+  setInterestingHeaders(webHeaderMask(HEADER_ACCEPT_ENCODING, HEADER_IF_NONE_MATCH, HEADER_IF_MODIFIED_SINCE,
+                                      HEADER_RANGE, HEADER_IF_RANGE));
+
+  // Ensure leading '/'
+  if (_uri.length() == 0 || _uri[0] != '/')
+    _uri = "/" + _uri;
+
+  // Remove the trailing '/', root will be "" not "/"
+  if (_uri[_uri.length() - 1] == '/')
+    _uri = _uri.substring(0, _uri.length() - 1);
+
+  setMethodMask(HTTP_GET);
+  setPathPrefix(_uri.c_str());
+}
+
+/////////////////////////////////////////////////
+
+const AsyncWebRomFile* AsyncRomWebHandler::_find(AsyncWebServerRequest *request) const
+{
+  const String& url = request->url();
+
+  if (!url.startsWith(_uri))
+    return NULL;
+
+  const char* path = url.c_str() + _uri.length();
+  const size_t len = url.length() - _uri.length();
+  const bool gzip = acceptsGzip(request->headerValue(HEADER_ACCEPT_ENCODING));
+
+  // "/static" doesn't serve "/staticfile"
+  if (len && path[0] != '/')
+    return NULL;
+
+  if (len == 0 || path[len - 1] == '/')
+  {
+    String index(path);
+
+    if (len == 0)
+      index += '/';
+
+    index += _defaultFile;
+
+    return _fs.find(index.c_str(), index.length(), gzip);
+  }
+
+  return _fs.find(path, len, gzip);
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncRomWebHandler::canHandle(AsyncWebServerRequest *request)
+{
+  if (request->method() != HTTP_GET || !request->isExpectedRequestedConnType(RCT_DEFAULT, RCT_HTTP))
+    return false;
+
+  return (_find(request) != NULL);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncRomWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+  const AsyncWebRomFile* file = _find(request);
+
+  if (file == NULL)
+  {
+    request->send(404);
+
+    return;
+  }
+
+  const char* lastModified = (_lastModified.length() ? _lastModified.c_str() : NULL);
+  AsyncWebServerResponse* response;
+
+  if (request->notModified(file->etag, lastModified))
+  {
+    response = request->beginResponse(304);
+    response->addHeader("ETag", file->etag);
+
+    if (strstr(file->headers, "Vary: "))
+      response->addHeader("Vary", "Accept-Encoding");
+  }
+  else
+  {
+    response = new AsyncRomFileResponse(*file);
+  }
+
+  if (lastModified)
+    response->addHeader("Last-Modified", lastModified);
+
+  if (_cacheControl.length())
+    response->addHeader("Cache-Control", _cacheControl);
+
+  request->send(response);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncCallbackWebHandler::setUri(const String& uri)
+{
+  _uri = uri;
+  _isRegex = uri.startsWith("^") && uri.endsWith("$");
+  _isTemplate = false;
+
+#ifdef ASYNCWEBSERVER_REGEX
+
+  if (_isRegex)
+  {
+    _pattern = std::regex(_uri.c_str());
+
+    return;
+  }
+
+#endif
+
+  const char* p = _uri.c_str();
+
+  while (!_isTemplate)
+  {
+    const char* slash = strchr(p, '/');
+    const size_t len = slash ? (size_t) (slash - p) : strlen(p);
+
+    _isTemplate = isParamSegment(p, len);
+
+    if (slash == NULL)
+      break;
+
+    p = slash + 1;
+  }
+}
+
+/////////////////////////////////////////////////
+
+// Without <regex>
+bool AsyncCallbackWebHandler::matchTemplate(const char* uri, AsyncWebServerRequest *request, bool addParams)
+{
+  const char* u = uri;
+  const char* p = request->url().c_str();
+
+  while (true)
+  {
+    const char* uriEnd = strchr(u, '/');
+    const char* urlEnd = strchr(p, '/');
+    const size_t uriLen = uriEnd ? (size_t) (uriEnd - u) : strlen(u);
+    const size_t urlLen = urlEnd ? (size_t) (urlEnd - p) : strlen(p);
+
+    if (isParamSegment(u, uriLen))
+    {
+      if (urlLen == 0)
+        return false;
+
+      if (addParams)
+        request->_addPathParam(p - request->url().c_str(), urlLen);
+    }
+    else if (uriLen != urlLen || memcmp(u, p, uriLen))
+    {
+      return false;
+    }
+
+    if (uriEnd == NULL || urlEnd == NULL)
+      return (uriEnd == urlEnd);
+
+    u = uriEnd + 1;
+    p = urlEnd + 1;
+  }
+}
+
+/////////////////////////////////////////////////
+
+AsyncRouteTableWebHandler::AsyncRouteTableWebHandler(const AsyncWebRoute* routes, size_t count)
+  : _routes(routes), _count(count), _templates(NULL)
+{
+  WebRequestMethodComposite methods = 0;
+
+  for (size_t i = 0; i < count; i++)
+    methods |= routes[i].methods;
+
+  setMethodMask(methods);
+
+  // Templates are told apart once, exact paths then only cost a strcmp() per lookup
+  _templates = new uint8_t[(count + 7) / 8];
+
+  if (_templates == NULL)
+    return;
+
+  memset(_templates, 0, (count + 7) / 8);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (strchr(routes[i].path, '{'))
+      _templates[i / 8] |= (1 << (i % 8));
+  }
+}
+
+/////////////////////////////////////////////////
+
+AsyncRouteTableWebHandler::~AsyncRouteTableWebHandler()
+{
+  delete[] _templates;
+}
+
+/////////////////////////////////////////////////
+
+// First route in table order taking the request, exact paths compared with strcmp(), "{name}" templates segment by segment
+const AsyncWebRoute* AsyncRouteTableWebHandler::_find(AsyncWebServerRequest *request) const
+{
+  const char* url = request->url().c_str();
+  const WebRequestMethodComposite method = request->method();
+
+  for (size_t i = 0; i < _count; i++)
+  {
+    const AsyncWebRoute* route = _routes + i;
+
+    if (!(route->methods & method))
+      continue;
+
+    if (_isTemplate(i) ? AsyncCallbackWebHandler::matchTemplate(route->path, request, false) : strcmp(route->path, url) == 0)
+      return route;
+  }
+
+  return NULL;
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncRouteTableWebHandler::canHandle(AsyncWebServerRequest *request)
+{
+  const AsyncWebRoute* route = _find(request);
+
+  if (route == NULL)
+    return false;
+
+  // Kept for handleRequest(), like the path params
+  request->_route = route;
+
+  if (_isTemplate(route - _routes))
+    AsyncCallbackWebHandler::matchTemplate(route->path, request, true);
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncRouteTableWebHandler::handleRequest(AsyncWebServerRequest *request)
+{
+  const AsyncWebRoute* route = request->_route;
+
+  if (route != NULL && route->handler != NULL)
+    route->handler(request);
+  else
+    request->send(500);
+}
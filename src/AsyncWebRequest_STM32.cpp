@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #if !defined(_ASYNCWEBSERVER_STM32_LOGLEVEL_)
@@ -56,25 +57,22 @@ enum { PARSE_REQ_START, PARSE_REQ_HEADERS, PARSE_REQ_BODY, PARSE_REQ_END, PARSE_
 /////////////////////////////////////////////////
 
 AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
-  : _client(c), _server(s), _handler(NULL), _response(NULL), _temp(), _parseState(0)
-  , _version(0), _method(HTTP_ANY), _url(), _host(), _contentType(), _boundary()
+  : _client(c), _server(s), _handler(NULL), _response(NULL), _temp(), _parseState(0), _version(0)
+  , _headLength(0), _lineStart(0), _query(0), _queryLength(0), _headerCount(0), _method(HTTP_ANY), _url(), _host(), _contentType(), _boundary()
   , _authorization(), _reqconntype(RCT_HTTP), _isDigest(false), _isMultipart(false)
-  , _isPlainPost(false), _expectingContinue(false), _contentLength(0), _parsedLength(0)
-  , _headers(LinkedList<AsyncWebHeader * >([](AsyncWebHeader * h)
-{
-  delete h;
-}))
-, _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p)
-{
-  delete p;
-}))
-, _pathParams(LinkedList<String *>([](String *p)
+  , _isPlainPost(false), _expectingContinue(false), _keepAlive(false), _requestCount(0)
+  , _contentLength(0), _parsedLength(0)
+  , _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p)
 {
   delete p;
 }))
-, _multiParseState(0), _boundaryPosition(0), _itemStartIndex(0), _itemSize(0), _itemName(), _itemFilename(), _itemType()
-, _itemValue(), _itemBuffer(0), _itemBufferIndex(0), _itemIsFile(false), _tempObject(NULL)
+, _pathParamCount(0), _route(NULL), _multiParseState(0), _boundaryPosition(0), _itemStartIndex(0), _itemSize(0), _itemName(), _itemFilename(), _itemType()
+, _itemValue(), _itemBuffer(0), _itemBufferIndex(0), _itemIsFile(false)
+, _pipeline(NULL), _pipelineLength(0), _bodyStash(NULL), _bodyStashLength(0), _rxSegment(0), _rxHeld(0)
+, _tempObject(NULL)
 {
+  memset(_headerIndex, 0, sizeof(_headerIndex));
+
   c->onError([](void *r, AsyncClient * c, int8_t error)
   {
     AWS_STM32_UNUSED(c);
@@ -107,6 +105,7 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   {
     AWS_STM32_UNUSED(c);
     AsyncWebServerRequest *req = (AsyncWebServerRequest*)r;
+    req->_rxSegment = len;
     req->_onData(buf, len);
   }, this);
 
@@ -122,10 +121,10 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
 
 AsyncWebServerRequest::~AsyncWebServerRequest()
 {
-  _headers.free();
+  _freeHeaders();
 
   _params.free();
-  _pathParams.free();
+  _freePathParams();
 
   _interestingHeaders.free();
 
@@ -138,6 +137,218 @@ AsyncWebServerRequest::~AsyncWebServerRequest()
   {
     free(_tempObject);
   }
+
+  if (_itemBuffer != NULL)
+  {
+    free(_itemBuffer);
+  }
+
+  if (_pipeline != NULL)
+  {
+    free(_pipeline);
+  }
+
+  if (_bodyStash != NULL)
+  {
+    free(_bodyStash);
+  }
+}
+
+/////////////////////////////////////////////////
+
+// Reset the parser so the next request on a kept-alive connection reuses this object and its AsyncClient
+void AsyncWebServerRequest::_recycle()
+{
+  LOGDEBUG1("_recycle: requests served =", _requestCount);
+
+  _freeHeaders();
+  _params.free();
+  _freePathParams();
+  _interestingHeaders.free();
+
+  if (_tempObject != NULL)
+  {
+    free(_tempObject);
+    _tempObject = NULL;
+  }
+
+  if (_itemBuffer != NULL)
+  {
+    free(_itemBuffer);
+    _itemBuffer = NULL;
+  }
+
+  _handler = NULL;
+  _route = NULL;
+  _onDisconnectfn = NULL;
+
+  _temp = String();
+  _parseState = PARSE_REQ_START;
+  _version = 0;
+  _method = HTTP_ANY;
+
+  _url = String();
+  _host = String();
+  _contentType = String();
+  _boundary = String();
+  _authorization = String();
+
+  _reqconntype = RCT_HTTP;
+  _isDigest = false;
+  _isMultipart = false;
+  _isPlainPost = false;
+  _expectingContinue = false;
+  _keepAlive = false;
+  _contentLength = 0;
+  _parsedLength = 0;
+
+  _multiParseState = 0;
+  _boundaryPosition = 0;
+  _itemStartIndex = 0;
+  _itemSize = 0;
+  _itemName = String();
+  _itemFilename = String();
+  _itemType = String();
+  _itemValue = String();
+  _itemBufferIndex = 0;
+  _itemIsFile = false;
+
+  // Wait for the next request, closing the connection in _onTimeout if none comes
+  _client->setRxTimeout(_server->_keepAliveTimeout);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_freeHeaders()
+{
+  for (uint8_t i = 0; i < _headerCount; i++)
+  {
+    if (_headers[i].object != NULL)
+      delete _headers[i].object;
+  }
+
+  _headerCount = 0;
+  memset(_headerIndex, 0, sizeof(_headerIndex));
+  _headLength = 0;
+  _lineStart = 0;
+  _query = 0;
+  _queryLength = 0;
+}
+
+/////////////////////////////////////////////////
+
+// Add the received bytes of the current line to the head arena, keeping room for its terminating NUL
+bool AsyncWebServerRequest::_appendHead(const char* data, size_t len)
+{
+  if (_headLength + len >= ASYNCWEBSERVER_REQUEST_HEAD_SIZE)
+  {
+    LOGDEBUG1("_appendHead: request head too large, len =", _headLength + len);
+
+    _parseState = PARSE_REQ_FAIL;
+    _keepAlive = false;
+    send(431);
+
+    return false;
+  }
+
+  memcpy(_head + _headLength, data, len);
+  _headLength += len;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+// Keep the bytes of the next requests received while the current one is still being answered
+bool AsyncWebServerRequest::_queuePipelined(const uint8_t* data, size_t len)
+{
+  if (_pipelineLength + len > ASYNCWEBSERVER_PIPELINE_BUFFER_SIZE)
+  {
+    LOGDEBUG1("_queuePipelined: buffer overflow, len =", _pipelineLength + len);
+
+    return false;
+  }
+
+  if (_pipeline == NULL)
+  {
+    _pipeline = (uint8_t*) malloc(ASYNCWEBSERVER_PIPELINE_BUFFER_SIZE);
+
+    if (_pipeline == NULL)
+      return false;
+  }
+
+  memcpy(_pipeline + _pipelineLength, data, len);
+  _pipelineLength += len;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+// Keep the body bytes a handleBodyStream() handler didn't consume, and the ones following them, until resumeBody()
+bool AsyncWebServerRequest::_stashBody(const uint8_t* data, size_t len)
+{
+  if (_bodyStashLength + len > ASYNCWEBSERVER_BODY_STASH_SIZE)
+  {
+    LOGDEBUG1("_stashBody: buffer overflow, len =", _bodyStashLength + len);
+
+    return false;
+  }
+
+  if (_bodyStash == NULL)
+  {
+    _bodyStash = (uint8_t*) malloc(ASYNCWEBSERVER_BODY_STASH_SIZE);
+
+    if (_bodyStash == NULL)
+      return false;
+  }
+
+  memcpy(_bodyStash + _bodyStashLength, data, len);
+  _bodyStashLength += len;
+
+  if (_rxSegment)
+  {
+    // Don't acknowledge the segment being received, so the receive window shrinks and the peer stops sending
+    _client->ackLater();
+    _rxHeld += _rxSegment;
+    _rxSegment = 0;
+
+    // The peer is waiting for us now, don't let the keep-alive idle timeout close the connection
+    _client->setRxTimeout(0);
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+// Acknowledge held back bytes once they are consumed, opening the receive window again
+void AsyncWebServerRequest::_releaseHeld(size_t len)
+{
+  if (len > _rxHeld)
+    len = _rxHeld;
+
+  _rxHeld -= len;
+  _client->ack(len);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::resumeBody()
+{
+  if (_bodyStashLength == 0)
+    return;
+
+  // _onData() may hold back part of the data again, so hand over the buffer
+  uint8_t* data = _bodyStash;
+  size_t len = _bodyStashLength;
+
+  _bodyStash = NULL;
+  _bodyStashLength = 0;
+  _rxSegment = 0;
+
+  _onData(data, len);
+  free(data);
 }
 
 /////////////////////////////////////////////////
@@ -146,36 +357,44 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len)
 {
   size_t i = 0;
 
+  if (_bodyStashLength)
+  {
+    // Body handler is still busy, queue the new data behind the held back one
+    if (!_stashBody((uint8_t*)buf, len))
+      _client->close();
+
+    return;
+  }
+
   while (true)
   {
-    if (_parseState < PARSE_REQ_BODY)
+    if (_parseState == PARSE_REQ_END)
+    {
+      // Pipelined request(s) arriving before the current response is done, parsed in _onResponseEnd()
+      if (_keepAlive && !_queuePipelined((uint8_t*)buf, len))
+        _client->close();
+
+      break;
+    }
+    else if (_parseState < PARSE_REQ_BODY)
     {
       // Find new line in buf
       char *str = (char*)buf;
+      char *eol = (char*) memchr(str, '\n', len);
 
-      for (i = 0; i < len; i++)
-      {
-        if (str[i] == '\n')
-        {
-          break;
-        }
-      }
-
-      if (i == len)
+      if (eol == NULL)
       {
-        // No new line, just add the buffer in _temp
-        char ch = str[len - 1];
-        str[len - 1] = 0;
-        _temp.reserve(_temp.length() + len);
-        _temp.concat(str);
-        _temp.concat(ch);
+        // No new line, just add the buffer to the current line
+        _appendHead(str, len);
       }
       else
       {
         // Found new line - extract it and parse
-        str[i] = 0; // Terminate the string at the end of the line.
-        _temp.concat(str);
-        _temp.trim();
+        i = eol - str;
+
+        if (!_appendHead(str, i))
+          break;
+
         _parseLine();
 
         if (++i < len)
@@ -193,18 +412,19 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len)
       // If handler does nothing (_onRequest is NULL), we don't need to really parse the body.
       const bool needParse = _handler && !_handler->isRequestHandlerTrivial();
 
+      // Bytes after the body belong to the next pipelined request
+      size_t rest = 0;
+
+      if (len > _contentLength - _parsedLength)
+      {
+        rest = len - (_contentLength - _parsedLength);
+        len -= rest;
+      }
+
       if (_isMultipart)
       {
         if (needParse)
-        {
-          size_t i;
-
-          for (i = 0; i < len; i++)
-          {
-            _parseMultipartPostByte(((uint8_t*)buf)[i], i == len - 1);
-            _parsedLength++;
-          }
-        }
+          _parseMultipartPost((uint8_t*)buf, len);
         else
           _parsedLength += len;
       }
@@ -231,22 +451,32 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len)
 
         if (!_isPlainPost)
         {
+          size_t consumed = len;
+
           //check if authenticated before calling the body
           if (_handler)
-            _handler->handleBody(this, (uint8_t*)buf, len, _parsedLength, _contentLength);
+            consumed = std::min(len, _handler->handleBodyStream(this, (uint8_t*)buf, len, _parsedLength, _contentLength));
 
-          _parsedLength += len;
-        }
-        else if (needParse)
-        {
-          size_t i;
+          _parsedLength += consumed;
+
+          // Whatever is left after a fully consumed chunk is parsed right away
+          if (_rxHeld)
+            _releaseHeld(consumed < len ? consumed : _rxHeld);
 
-          for (i = 0; i < len; i++)
+          if (consumed < len)
           {
-            _parsedLength++;
-            _parsePlainPostChar(((uint8_t*)buf)[i]);
+            // Handler can't keep up, hold back the rest of the data until it is offered again
+            if (!_stashBody((uint8_t*)buf + consumed, len - consumed + rest))
+              _client->close();
+
+            break;
           }
         }
+        else if (needParse)
+        {
+          _parsePlainPost((char*)buf, len, _parsedLength + len == _contentLength);
+          _parsedLength += len;
+        }
         else
         {
           _parsedLength += len;
@@ -263,6 +493,13 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len)
 
         else
           send(501);
+
+        if (rest)
+        {
+          buf = (uint8_t*)buf + len;
+          len = rest;
+          continue;
+        }
       }
     }
 
@@ -274,16 +511,40 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len)
 
 void AsyncWebServerRequest::_removeNotInterestingHeaders()
 {
-  if (_interestingHeaders.containsIgnoreCase("ANY"))
+  const WebHeaderMask mask = (_handler ? _handler->interestingHeaders() : HEADER_MASK_NONE);
+
+  if (mask == HEADER_MASK_ANY || _interestingHeaders.containsIgnoreCase("ANY"))
     return; // nothing to do
 
-  for (const auto& header : _headers)
+  uint8_t kept = 0;
+
+  for (uint8_t i = 0; i < _headerCount; i++)
   {
-    if (!_interestingHeaders.containsIgnoreCase(header->name().c_str()))
+    bool interesting = (mask & webHeaderMask((WebHeaderId) _headers[i].id));
+
+    if (!interesting)
     {
-      _headers.remove(header);
+      // Headers asked for by name with addInterestingHeader()
+      const char* name = _head + _headers[i].name;
+
+      for (const auto& h : _interestingHeaders)
+      {
+        if (!strcasecmp(h.c_str(), name))
+        {
+          interesting = true;
+          break;
+        }
+      }
     }
+
+    if (interesting)
+      _headers[kept++] = _headers[i];
+    else if (_headers[i].object != NULL)
+      delete _headers[i].object;
   }
+
+  _headerCount = kept;
+  _indexHeaders();
 }
 
 /////////////////////////////////////////////////
@@ -294,7 +555,18 @@ void AsyncWebServerRequest::_onPoll()
 
   if (_response != NULL && _client != NULL && _client->canSend() && !_response->_finished())
   {
+    // Responses which don't keep the connection alive may delete this request inside _ack()
+    const bool keepAlive = _response->_keepAlive;
+
     _response->_ack(this, 0, 0);
+
+    if (keepAlive && _response->_finished())
+      _onResponseEnd();
+  }
+  else if (_bodyStashLength)
+  {
+    // Retry the body handler which couldn't keep up
+    resumeBody();
   }
 }
 
@@ -306,17 +578,68 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time)
 
   if (_response != NULL)
   {
+    // Responses which can hand the connection over (WebSocket, EventSource) never keep it alive,
+    // and may delete this request inside _ack()
+    if (!_response->_keepAlive)
+    {
+      if (!_response->_finished())
+      {
+        _response->_ack(this, len, time);
+      }
+      else
+      {
+        AsyncWebServerResponse* r = _response;
+        _response = NULL;
+        delete r;
+      }
+
+      return;
+    }
+
     if (!_response->_finished())
     {
       _response->_ack(this, len, time);
+
+      if (!_response->_finished())
+        return;
     }
-    else
+
+    _onResponseEnd();
+  }
+}
+
+/////////////////////////////////////////////////
+
+// Called once a kept-alive response is completely sent and acknowledged
+void AsyncWebServerRequest::_onResponseEnd()
+{
+  AsyncWebServerResponse* r = _response;
+  _response = NULL;
+  delete r;
+
+  if (_parseState == PARSE_REQ_END)
+  {
+    _recycle();
+
+    if (_pipelineLength)
     {
-      AsyncWebServerResponse* r = _response;
-      _response = NULL;
-      delete r;
+      // _onData() may queue the requests following the next one again, so hand over the buffer
+      uint8_t* data = _pipeline;
+      size_t len = _pipelineLength;
+
+      _pipeline = NULL;
+      _pipelineLength = 0;
+      _rxSegment = 0;
+
+      _onData(data, len);
+      free(data);
     }
   }
+  else
+  {
+    // Response was sent before the whole body arrived, the connection can't be reused
+    _client->close();
+  }
 }
 
 /////////////////////////////////////////////////
@@ -362,6 +685,8 @@ void AsyncWebServerRequest::_onDisconnect()
 
 void AsyncWebServerRequest::_addParam(AsyncWebParameter *p)
 {
+  // Keep the params of the query string first
+  _parseGetParams();
   _params.add(p);
 }
 
@@ -369,228 +694,487 @@ void AsyncWebServerRequest::_addParam(AsyncWebParameter *p)
 
 void AsyncWebServerRequest::_addPathParam(const char *p)
 {
-  _pathParams.add(new String(p));
+  if (_pathParamCount >= ASYNCWEBSERVER_REQUEST_MAX_PATH_PARAMS)
+  {
+    LOGDEBUG1("_addPathParam: too many path params, ignored", p);
+
+    return;
+  }
+
+  // Not a slice of the url, keep its own copy
+  AsyncWebPathParamSlice& param = _pathParams[_pathParamCount++];
+
+  param.object = new String(p);
+  param.offset = 0;
+  param.length = param.object->length();
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_addGetParams(const String& params)
+void AsyncWebServerRequest::_addPathParam(size_t offset, size_t len)
 {
-  size_t start = 0;
-
-  while (start < params.length())
+  if (_pathParamCount >= ASYNCWEBSERVER_REQUEST_MAX_PATH_PARAMS)
   {
-    int end = params.indexOf('&', start);
+    LOGDEBUG1("_addPathParam: too many path params, ignored offset =", offset);
 
-    if (end < 0)
-      end = params.length();
-
-    int equal = params.indexOf('=', start);
+    return;
+  }
 
-    if (equal < 0 || equal > end)
-      equal = end;
+  AsyncWebPathParamSlice& param = _pathParams[_pathParamCount++];
 
-    String name = params.substring(start, equal);
-    String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value)));
-    start = end + 1;
-  }
+  param.offset = offset;
+  param.length = len;
+  param.object = NULL;
 }
 
 /////////////////////////////////////////////////
 
-bool AsyncWebServerRequest::_parseReqHead()
+void AsyncWebServerRequest::_freePathParams()
 {
-  // Split the head into method, url and version
-  int index = _temp.indexOf(' ');
-  String m = _temp.substring(0, index);
-  index = _temp.indexOf(' ', index + 1);
-  String u = _temp.substring(m.length() + 1, index);
-  _temp = _temp.substring(index + 1);
-
-  if (m == "GET")
-  {
-    _method = HTTP_GET;
-  }
-  else if (m == "POST")
-  {
-    _method = HTTP_POST;
-  }
-  else if (m == "DELETE")
-  {
-    _method = HTTP_DELETE;
-  }
-  else if (m == "PUT")
-  {
-    _method = HTTP_PUT;
-  }
-  else if (m == "PATCH")
-  {
-    _method = HTTP_PATCH;
-  }
-  else if (m == "HEAD")
-  {
-    _method = HTTP_HEAD;
-  }
-  else if (m == "OPTIONS")
+  for (uint8_t i = 0; i < _pathParamCount; i++)
   {
-    _method = HTTP_OPTIONS;
+    if (_pathParams[i].object != NULL)
+      delete _pathParams[i].object;
   }
 
-  String g = String();
-  index = u.indexOf('?');
-
-  if (index > 0)
-  {
-    g = u.substring(index + 1);
-    u = u.substring(0, index);
-  }
+  _pathParamCount = 0;
+}
 
-  _url = urlDecode(u);
-  _addGetParams(g);
+/////////////////////////////////////////////////
 
-  if (!_temp.startsWith("HTTP/1.0"))
-    _version = 1;
+void AsyncWebServerRequest::_addGetParams(const String& params)
+{
+  _parseGetParams();
+  _addGetParams(params.c_str(), params.length());
+}
 
-  _temp = String();
+/////////////////////////////////////////////////
 
-  return true;
+void AsyncWebServerRequest::_addGetParams(const char* params, size_t len) const
+{
+  _splitParams(params, len, _params);
 }
 
 /////////////////////////////////////////////////
 
-bool strContains(String src, String find, bool mindcase = true)
+void AsyncWebServerRequest::_splitParams(const char* params, size_t len, LinkedList<AsyncWebParameter *>& list)
 {
-  int pos = 0, i = 0;
-  const int slen = src.length();
-  const int flen = find.length();
-
-  if (slen < flen)
-    return false;
+  const char* end = params + len;
 
-  while (pos <= (slen - flen))
+  while (params < end)
   {
-    for (i = 0; i < flen; i++)
-    {
-      if (mindcase)
-      {
-        if (src[pos + i] != find[i])
-          i = flen + 1; // no match
-      }
-      else if (tolower(src[pos + i]) != tolower(find[i]))
-        i = flen + 1; // no match
-    }
+    const char* next = (const char*) memchr(params, '&', end - params);
 
-    if (i == flen)
-      return true;
+    if (next == NULL)
+      next = end;
 
-    pos++;
-  }
+    const char* equal = (const char*) memchr(params, '=', next - params);
+    const char* value = next;
 
-  return false;
-}
+    if (equal == NULL)
+      equal = next;
+    else
+      value = equal + 1;
+
+    list.add(new AsyncWebParameter(_urlDecode(params, equal - params), _urlDecode(value, next - value)));
+    params = next + 1;
+  }
+}
 
 /////////////////////////////////////////////////
 
-bool AsyncWebServerRequest::_parseReqHeader()
+// The query string stays in the head arena until the first access to the params
+void AsyncWebServerRequest::_parseGetParams() const
 {
-  int index = _temp.indexOf(':');
+  if (_queryLength)
+  {
+    const size_t len = _queryLength;
 
-  if (index)
+    _queryLength = 0;
+    _addGetParams(_head + _query, len);
+  }
+}
+
+/////////////////////////////////////////////////
+
+// Method tokens are case-sensitive, dispatch on length and first char so at most one compare is done
+static WebRequestMethodComposite parseMethod(const char* m, size_t len)
+{
+  switch (len)
   {
-    String name = _temp.substring(0, index);
-    String value = _temp.substring(index + 2);
+    case 3:
+      if (m[0] == 'G' && !memcmp(m, "GET", 3))
+        return HTTP_GET;
+      else if (m[0] == 'P' && !memcmp(m, "PUT", 3))
+        return HTTP_PUT;
+
+      break;
+
+    case 4:
+      if (m[0] == 'P' && !memcmp(m, "POST", 4))
+        return HTTP_POST;
+      else if (m[0] == 'H' && !memcmp(m, "HEAD", 4))
+        return HTTP_HEAD;
+
+      break;
+
+    case 5:
+      if (!memcmp(m, "PATCH", 5))
+        return HTTP_PATCH;
+
+      break;
+
+    case 6:
+      if (!memcmp(m, "DELETE", 6))
+        return HTTP_DELETE;
+
+      break;
+
+    case 7:
+      if (!memcmp(m, "OPTIONS", 7))
+        return HTTP_OPTIONS;
+
+      break;
+  }
+
+  return HTTP_UNKNOWN;
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerRequest::_parseReqHead()
+{
+  // Split the head into method, url and version
+  char* m = _head + _lineStart;
+  char* end = _head + _headLength - 1;
+  char* u = (char*) memchr(m, ' ', end - m);
+
+  if (u == NULL)
+    u = end;
+
+  const size_t mlen = u - m;
+
+  if (u < end)
+    u++;
+
+  char* v = (char*) memchr(u, ' ', end - u);
+
+  if (v == NULL)
+    v = end;
+
+  const size_t ulen = v - u;
+
+  if (v < end)
+    v++;
+
+  _method = parseMethod(m, mlen);
+
+  const char* q = (const char*) memchr(u, '?', ulen);
+
+  if (q != NULL && q > u)
+  {
+    _query = q + 1 - _head;
+    _queryLength = u + ulen - (q + 1);
+    _url = _urlDecode(u, q - u);
+  }
+  else
+  {
+    _url = _urlDecode(u, ulen);
+  }
+
+  if (strncmp(v, "HTTP/1.0", 8))
+    _version = 1;
+
+  // HTTP/1.1 connections are persistent unless the client sends "Connection: close"
+  _keepAlive = (_version == 1);
+  _requestCount++;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
 
-    if (name.equalsIgnoreCase("Host"))
+bool strContains(const char* src, const char* find, bool mindcase = true)
+{
+  int pos = 0, i = 0;
+  const int slen = strlen(src);
+  const int flen = strlen(find);
+
+  if (slen < flen)
+    return false;
+
+  while (pos <= (slen - flen))
+  {
+    for (i = 0; i < flen; i++)
     {
-      _host = value;
+      if (mindcase)
+      {
+        if (src[pos + i] != find[i])
+          i = flen + 1; // no match
+      }
+      else if (tolower(src[pos + i]) != tolower(find[i]))
+        i = flen + 1; // no match
     }
-    else if (name.equalsIgnoreCase("Content-Type"))
+
+    if (i == flen)
+      return true;
+
+    pos++;
+  }
+
+  return false;
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerRequest::_parseReqHeader()
+{
+  char* name = _head + _lineStart;
+  char* end = _head + _headLength - 1;
+  char* colon = (char*) memchr(name, ':', end - name);
+
+  if (colon > name)
+  {
+    // Terminate the name in place and skip the optional whitespace before the value
+    *colon = 0;
+    char* value = colon + 1;
+
+    while (value < end && (*value == ' ' || *value == '\t'))
+      value++;
+
+    const size_t valueLength = end - value;
+
+    const WebHeaderId id = webHeaderId(name, colon - name);
+
+    switch (id)
     {
-      _contentType = value.substring(0, value.indexOf(';'));
+      case HEADER_HOST:
+        _host = value;
+        break;
 
-      if (value.startsWith("multipart/"))
+      case HEADER_CONTENT_TYPE:
       {
-        _boundary = value.substring(value.indexOf('=') + 1);
-        _boundary.replace("\"", "");
-        _isMultipart = true;
+        // Cut the parameters off temporarily, the full value stays available in the header
+        char* semicolon = strchr(value, ';');
+
+        if (semicolon)
+          *semicolon = 0;
+
+        _contentType = value;
+
+        if (semicolon)
+          *semicolon = ';';
+
+        if (!strncmp(value, "multipart/", 10))
+        {
+          const char* equal = strchr(value, '=');
+
+          // Keep the whole delimiter, the multipart parser searches for it in the body
+          _boundary = "\r\n--";
+          _boundary += (equal ? equal + 1 : value);
+          _boundary.replace("\"", "");
+          _isMultipart = true;
+        }
+
+        break;
       }
+
+      case HEADER_CONTENT_LENGTH:
+        _contentLength = atoi(value);
+        break;
+
+      case HEADER_CONNECTION:
+        if (strContains(value, "close", false))
+          _keepAlive = false;
+        else if (strContains(value, "keep-alive", false))
+          _keepAlive = true;
+
+        break;
+
+      case HEADER_EXPECT:
+        if (!strcmp(value, "100-continue"))
+          _expectingContinue = true;
+
+        break;
+
+      case HEADER_AUTHORIZATION:
+        if (valueLength > 5 && !strncasecmp(value, "Basic", 5))
+        {
+          _authorization = value + 6;
+        }
+        else if (valueLength > 6 && !strncasecmp(value, "Digest", 6))
+        {
+          _isDigest = true;
+          _authorization = value + 7;
+        }
+
+        break;
+
+      case HEADER_UPGRADE:
+        // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
+        if (!strcasecmp(value, "websocket"))
+          _reqconntype = RCT_WS;
+
+        break;
+
+      case HEADER_ACCEPT:
+        // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
+        if (strContains(value, "text/event-stream", false))
+          _reqconntype = RCT_EVENT;
+
+        break;
+
+      default:
+        break;
     }
-    else if (name.equalsIgnoreCase("Content-Length"))
+
+    // No handler needs it, give the arena space back
+    if (!(_server->_headerMask & webHeaderMask(id)))
     {
-      _contentLength = atoi(value.c_str());
+      _headLength = _lineStart;
+
+      return true;
     }
-    else if (name.equalsIgnoreCase("Expect") && value == "100-continue")
+
+    if (_headerCount == ASYNCWEBSERVER_REQUEST_MAX_HEADERS)
     {
-      _expectingContinue = true;
+      LOGDEBUG1("_parseReqHeader: too many headers, max =", ASYNCWEBSERVER_REQUEST_MAX_HEADERS);
+
+      _parseState = PARSE_REQ_FAIL;
+      _keepAlive = false;
+      send(431);
+
+      return false;
     }
-    else if (name.equalsIgnoreCase("Authorization"))
+
+    AsyncWebHeaderSlice& header = _headers[_headerCount++];
+
+    header.name = name - _head;
+    header.nameLength = colon - name;
+    header.value = value - _head;
+    header.valueLength = valueLength;
+    header.id = id;
+    header.object = NULL;
+
+    if (id != HEADER_MAX && !_headerIndex[id])
+      _headerIndex[id] = _headerCount;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+// Fields split by TCP segments are collected in _temp, the others are decoded straight from the segment
+void AsyncWebServerRequest::_parsePlainPost(const char* data, size_t len, bool last)
+{
+  const char* end = data + len;
+
+  while (data < end)
+  {
+    const char* next = (const char*) memchr(data, '&', end - data);
+
+    if (next == NULL)
     {
-      if (value.length() > 5 && value.substring(0, 5).equalsIgnoreCase("Basic"))
-      {
-        _authorization = value.substring(6);
-      }
-      else if (value.length() > 6 && value.substring(0, 6).equalsIgnoreCase("Digest"))
+      if (!last)
       {
-        _isDigest = true;
-        _authorization = value.substring(7);
+        _temp.reserve(_temp.length() + (end - data));
+
+        while (data < end)
+          _temp += *data++;
+
+        return;
       }
+
+      next = end;
+    }
+
+    if (_temp.length())
+    {
+      _temp.reserve(_temp.length() + (next - data));
+
+      while (data < next)
+        _temp += *data++;
+
+      _addPlainPostParam(_temp.c_str(), _temp.length());
+      _temp = String();
     }
     else
     {
-      if (name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket"))
-      {
-        // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
-        _reqconntype = RCT_WS;
-      }
-      else
-      {
-        if (name.equalsIgnoreCase("Accept") && strContains(value, "text/event-stream", false))
-        {
-          // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
-          _reqconntype = RCT_EVENT;
-        }
-      }
+      _addPlainPostParam(data, next - data);
     }
 
-    _headers.add(new AsyncWebHeader(name, value));
+    data = next + 1;
   }
 
-  _temp = String();
+  if (last && _temp.length())
+  {
+    _addPlainPostParam(_temp.c_str(), _temp.length());
+    _temp = String();
+  }
+}
 
-  return true;
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_addPlainPostParam(const char* field, size_t len)
+{
+  if (!len)
+    return;
+
+  const char* equal = (const char*) memchr(field, '=', len);
+
+  // Bodies which aren't name=value pairs, like JSON, are kept whole as "body"
+  if (field[0] != '{' && field[0] != '[' && equal != NULL && equal > field)
+  {
+    _addParam(new AsyncWebParameter(_urlDecode(field, equal - field), _urlDecode(equal + 1, field + len - (equal + 1)),
+                                    true));
+  }
+  else
+  {
+    _addParam(new AsyncWebParameter("body", _urlDecode(field, len), true));
+  }
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_parsePlainPostChar(uint8_t data)
+bool AsyncWebServerRequest::_zeroCopyItem() const
 {
-  if (data && (char)data != '&')
-    _temp += (char)data;
+  return _itemIsFile && _handler && _handler->zeroCopyUpload();
+}
+
+/////////////////////////////////////////////////
 
-  if (!data || (char)data == '&' || _parsedLength == _contentLength)
+void AsyncWebServerRequest::_handleUploadData(const uint8_t* data, size_t len)
+{
+  if (_zeroCopyItem())
   {
-    String name = "body";
-    String value = _temp;
+    // Straight from the received segment
+    _handler->handleUpload(this, _itemFilename, _itemSize, (uint8_t*) data, len, false);
+    _itemSize += len;
 
-    if (!_temp.startsWith("{") && !_temp.startsWith("[") && _temp.indexOf('=') > 0)
-    {
-      name = _temp.substring(0, _temp.indexOf('='));
-      value = _temp.substring(_temp.indexOf('=') + 1);
-    }
+    return;
+  }
 
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value), true));
-    _temp = String();
+  while (len)
+  {
+    size_t n = std::min(len, (size_t) (1460 - _itemBufferIndex));
+
+    memcpy(_itemBuffer + _itemBufferIndex, data, n);
+    _itemBufferIndex += n;
+    _itemSize += n;
+    data += n;
+    len -= n;
+
+    if (_itemBufferIndex == 1460)
+      _flushUpload();
   }
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_handleUploadByte(uint8_t data, bool last)
+void AsyncWebServerRequest::_flushUpload()
 {
-  _itemBuffer[_itemBufferIndex++] = data;
-
-  if (last || _itemBufferIndex == 1460)
+  if (_itemBufferIndex)
   {
     //check if authenticated before calling the upload
     if (_handler)
@@ -606,11 +1190,7 @@ enum
 {
   EXPECT_BOUNDARY,
   PARSE_HEADERS,
-  WAIT_FOR_RETURN1,
-  EXPECT_FEED1,
-  EXPECT_DASH1,
-  EXPECT_DASH2,
-  BOUNDARY_OR_DATA,
+  PARSE_ITEM_DATA,
   DASH3_OR_RETURN2,
   EXPECT_FEED2,
   PARSING_FINISHED,
@@ -619,233 +1199,271 @@ enum
 
 /////////////////////////////////////////////////
 
-void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last)
+void AsyncWebServerRequest::_itemWrite(const uint8_t* data, size_t len)
 {
-#define itemWriteByte(b) do { _itemSize++; if(_itemIsFile) _handleUploadByte(b, last); else _itemValue+=(char)(b); } while(0)
+  if (!len)
+    return;
 
-  if (!_parsedLength)
+  if (_itemIsFile)
   {
-    _multiParseState = EXPECT_BOUNDARY;
-    _temp = String();
-    _itemName = String();
-    _itemFilename = String();
-    _itemType = String();
+    _handleUploadData(data, len);
   }
-
-  if (_multiParseState == WAIT_FOR_RETURN1)
+  else
   {
-    if (data != '\r')
-    {
-      itemWriteByte(data);
-    }
-    else
-    {
-      _multiParseState = EXPECT_FEED1;
-    }
+    _itemSize += len;
+    _itemValue.reserve(_itemValue.length() + len);
+
+    while (len--)
+      _itemValue += (char) * data++;
   }
-  else if (_multiParseState == EXPECT_BOUNDARY)
+}
+
+/////////////////////////////////////////////////
+
+// Write the first len bytes of the delimiter, found to be item data after all
+void AsyncWebServerRequest::_itemReplay(size_t len)
+{
+  if (_zeroCopyItem())
   {
-    if (_parsedLength < 2 && data != '-')
-    {
-      _multiParseState = PARSE_ERROR;
+    // Only case where a zero-copy upload needs a buffer, the handler may change the data it gets
+    if (_itemBuffer == NULL)
+      _itemBuffer = (uint8_t*) malloc(_boundary.length());
 
-      return;
-    }
-    else if (_parsedLength - 2 < _boundary.length() && _boundary.c_str()[_parsedLength - 2] != data)
+    if (_itemBuffer == NULL)
     {
       _multiParseState = PARSE_ERROR;
 
       return;
     }
-    else if (_parsedLength - 2 == _boundary.length() && data != '\r')
-    {
-      _multiParseState = PARSE_ERROR;
 
-      return;
-    }
-    else if (_parsedLength - 3 == _boundary.length())
-    {
-      if (data != '\n')
-      {
-        _multiParseState = PARSE_ERROR;
+    memcpy(_itemBuffer, _boundary.c_str(), len);
+    _handleUploadData(_itemBuffer, len);
+  }
+  else
+  {
+    _itemWrite((const uint8_t*) _boundary.c_str(), len);
+  }
+}
 
-        return;
-      }
+/////////////////////////////////////////////////
 
-      _multiParseState = PARSE_HEADERS;
-      _itemIsFile = false;
-    }
+void AsyncWebServerRequest::_parseMultipartHeader()
+{
+  if (_temp.length() > 12 && _temp.substring(0, 12).equalsIgnoreCase("Content-Type"))
+  {
+    _itemType = _temp.substring(14);
+    _itemIsFile = true;
   }
-  else if (_multiParseState == PARSE_HEADERS)
+  else if (_temp.length() > 19 && _temp.substring(0, 19).equalsIgnoreCase("Content-Disposition"))
   {
-    if ((char)data != '\r' && (char)data != '\n')
-      _temp += (char)data;
+    _temp = _temp.substring(_temp.indexOf(';') + 2);
 
-    if ((char)data == '\n')
+    while (_temp.indexOf(';') > 0)
     {
-      if (_temp.length())
+      String name = _temp.substring(0, _temp.indexOf('='));
+      String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.indexOf(';') - 1);
+
+      if (name == "name")
       {
-        if (_temp.length() > 12 && _temp.substring(0, 12).equalsIgnoreCase("Content-Type"))
-        {
-          _itemType = _temp.substring(14);
-          _itemIsFile = true;
-        }
-        else if (_temp.length() > 19 && _temp.substring(0, 19).equalsIgnoreCase("Content-Disposition"))
-        {
-          _temp = _temp.substring(_temp.indexOf(';') + 2);
+        _itemName = nameVal;
+      }
+      else if (name == "filename")
+      {
+        _itemFilename = nameVal;
+        _itemIsFile = true;
+      }
 
-          while (_temp.indexOf(';') > 0)
-          {
-            String name = _temp.substring(0, _temp.indexOf('='));
-            String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.indexOf(';') - 1);
+      _temp = _temp.substring(_temp.indexOf(';') + 2);
+    }
 
-            if (name == "name")
-            {
-              _itemName = nameVal;
-            }
-            else if (name == "filename")
-            {
-              _itemFilename = nameVal;
-              _itemIsFile = true;
-            }
+    String name = _temp.substring(0, _temp.indexOf('='));
+    String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.length() - 1);
 
-            _temp = _temp.substring(_temp.indexOf(';') + 2);
-          }
+    if (name == "name")
+    {
+      _itemName = nameVal;
+    }
+    else if (name == "filename")
+    {
+      _itemFilename = nameVal;
+      _itemIsFile = true;
+    }
+  }
 
-          String name = _temp.substring(0, _temp.indexOf('='));
-          String nameVal = _temp.substring(_temp.indexOf('=') + 2, _temp.length() - 1);
+  _temp = String();
+}
 
-          if (name == "name")
-          {
-            _itemName = nameVal;
-          }
-          else if (name == "filename")
-          {
-            _itemFilename = nameVal;
-            _itemIsFile = true;
-          }
-        }
+/////////////////////////////////////////////////
 
-        _temp = String();
-      }
-      else
-      {
-        _multiParseState = WAIT_FOR_RETURN1;
-        //value starts from here
-        _itemSize = 0;
-        _itemStartIndex = _parsedLength;
-        _itemValue = String();
+bool AsyncWebServerRequest::_startMultipartItem()
+{
+  //value starts from here
+  _multiParseState = PARSE_ITEM_DATA;
+  _boundaryPosition = 0;
+  _itemSize = 0;
+  _itemStartIndex = _parsedLength;
+  _itemValue = String();
 
-        if (_itemIsFile)
-        {
-          if (_itemBuffer)
-            free(_itemBuffer);
+  if (_itemBuffer)
+  {
+    free(_itemBuffer);
+    _itemBuffer = NULL;
+  }
 
-          _itemBuffer = (uint8_t*) malloc(1460);
+  _itemBufferIndex = 0;
 
-          if (_itemBuffer == NULL)
-          {
-            _multiParseState = PARSE_ERROR;
+  if (_itemIsFile && !_zeroCopyItem())
+  {
+    _itemBuffer = (uint8_t*) malloc(1460);
 
-            return;
-          }
+    if (_itemBuffer == NULL)
+    {
+      _multiParseState = PARSE_ERROR;
 
-          _itemBufferIndex = 0;
-        }
-      }
+      return false;
     }
   }
-  else if (_multiParseState == EXPECT_FEED1)
-  {
-    if (data != '\n')
-    {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
 
-      _parseMultipartPostByte(data, last);
-    }
-    else
-    {
-      _multiParseState = EXPECT_DASH1;
-    }
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_endMultipartItem()
+{
+  if (!_itemIsFile)
+  {
+    _addParam(new AsyncWebParameter(_itemName, _itemValue, true));
   }
-  else if (_multiParseState == EXPECT_DASH1)
+  else
   {
-    if (data != '-')
+    if (_itemSize)
     {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
+      //check if authenticated before calling the upload
+      if (_handler)
+      {
+        if (_zeroCopyItem())
+          _handler->handleUpload(this, _itemFilename, _itemSize, NULL, 0, true);
+        else
+          _handler->handleUpload(this, _itemFilename, _itemSize - _itemBufferIndex, _itemBuffer, _itemBufferIndex, true);
+      }
 
-      _parseMultipartPostByte(data, last);
-    }
-    else
-    {
-      _multiParseState = EXPECT_DASH2;
+      _itemBufferIndex = 0;
+      _addParam(new AsyncWebParameter(_itemName, _itemFilename, true, true, _itemSize));
     }
+
+    free(_itemBuffer);
+    _itemBuffer = NULL;
   }
-  else if (_multiParseState == EXPECT_DASH2)
+}
+
+/////////////////////////////////////////////////
+
+// Item content is searched for the "\r\n--boundary" delimiter and copied in spans. A delimiter split between
+// two segments is tracked by _boundaryPosition, its bytes are replayed from _boundary if it turns out to be data
+size_t AsyncWebServerRequest::_parseMultipartData(uint8_t* data, size_t len)
+{
+  const uint8_t* delimiter = (const uint8_t*) _boundary.c_str();
+  const size_t delimiterLength = _boundary.length();
+  uint8_t* start = data;
+  uint8_t* p = data;
+  uint8_t* end = data + len;
+
+  if (_boundaryPosition)
   {
-    if (data != '-')
+    while (p < end && _boundaryPosition < delimiterLength && *p == delimiter[_boundaryPosition])
     {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
-
-      _parseMultipartPostByte(data, last);
+      p++;
+      _boundaryPosition++;
     }
-    else
+
+    if (_boundaryPosition == delimiterLength)
     {
-      _multiParseState = BOUNDARY_OR_DATA;
       _boundaryPosition = 0;
+      _endMultipartItem();
+      _multiParseState = DASH3_OR_RETURN2;
+
+      return p - start;
     }
+
+    if (p == end)
+      return len;
+
+    // Not a delimiter, continue the search from the mismatching byte
+    _itemReplay(_boundaryPosition);
+    _boundaryPosition = 0;
+    data = p;
   }
-  else if (_multiParseState == BOUNDARY_OR_DATA)
+
+  uint8_t* match = NULL;
+  size_t matched = 0;
+
+  while ((p = (uint8_t*) memchr(p, '\r', end - p)) != NULL)
   {
-    if (_boundaryPosition < _boundary.length() && _boundary.c_str()[_boundaryPosition] != data)
+    matched = std::min(delimiterLength, (size_t) (end - p));
+
+    if (!memcmp(p, delimiter, matched))
     {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
-      itemWriteByte('-');
+      match = p;
+      break;
+    }
 
-      uint8_t i;
+    p++;
+  }
 
-      for (i = 0; i < _boundaryPosition; i++)
-        itemWriteByte(_boundary.c_str()[i]);
+  if (match == NULL)
+  {
+    _itemWrite(data, end - data);
+  }
+  else
+  {
+    _itemWrite(data, match - data);
 
-      _parseMultipartPostByte(data, last);
+    if (matched < delimiterLength)
+    {
+      // Delimiter may continue in the next segment
+      _boundaryPosition = matched;
     }
-    else if (_boundaryPosition == _boundary.length() - 1)
+    else
     {
+      _endMultipartItem();
       _multiParseState = DASH3_OR_RETURN2;
 
-      if (!_itemIsFile)
-      {
-        _addParam(new AsyncWebParameter(_itemName, _itemValue, true));
-      }
-      else
-      {
-        if (_itemSize)
-        {
-          //check if authenticated before calling the upload
-          if (_handler)
-            _handler->handleUpload(this, _itemFilename, _itemSize - _itemBufferIndex, _itemBuffer, _itemBufferIndex, true);
+      return match + delimiterLength - start;
+    }
+  }
 
-          _itemBufferIndex = 0;
-          _addParam(new AsyncWebParameter(_itemName, _itemFilename, true, true, _itemSize));
-        }
+  return len;
+}
 
-        free(_itemBuffer);
-        _itemBuffer = NULL;
-      }
+/////////////////////////////////////////////////
 
+void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data)
+{
+  if (_multiParseState == EXPECT_BOUNDARY)
+  {
+    // Body starts with "--boundary\r\n", _boundary holds "\r\n--boundary"
+    const size_t boundaryLength = _boundary.length() - 2;
+
+    if (_parsedLength < boundaryLength && _boundary.c_str()[_parsedLength + 2] != data)
+    {
+      _multiParseState = PARSE_ERROR;
     }
-    else
+    else if (_parsedLength == boundaryLength && data != '\r')
     {
-      _boundaryPosition++;
+      _multiParseState = PARSE_ERROR;
+    }
+    else if (_parsedLength == boundaryLength + 1)
+    {
+      if (data != '\n')
+      {
+        _multiParseState = PARSE_ERROR;
+
+        return;
+      }
+
+      _multiParseState = PARSE_HEADERS;
+      _itemIsFile = false;
     }
   }
   else if (_multiParseState == DASH3_OR_RETURN2)
@@ -868,18 +1486,7 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last)
     }
     else
     {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
-      itemWriteByte('-');
-
-      uint8_t i;
-
-      for (i = 0; i < _boundary.length(); i++)
-        itemWriteByte(_boundary.c_str()[i]);
-
-      _parseMultipartPostByte(data, last);
+      _multiParseState = PARSE_ERROR;
     }
   }
   else if (_multiParseState == EXPECT_FEED2)
@@ -891,32 +1498,111 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last)
     }
     else
     {
-      _multiParseState = WAIT_FOR_RETURN1;
-      itemWriteByte('\r');
-      itemWriteByte('\n');
-      itemWriteByte('-');
-      itemWriteByte('-');
-
-      uint8_t i;
-
-      for (i = 0; i < _boundary.length(); i++)
-        itemWriteByte(_boundary.c_str()[i]);
-
-      itemWriteByte('\r');
-
-      _parseMultipartPostByte(data, last);
+      _multiParseState = PARSE_ERROR;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_parseMultipartPost(uint8_t* data, size_t len)
+{
+  if (!_parsedLength)
+  {
+    _multiParseState = EXPECT_BOUNDARY;
+    _temp = String();
+    _itemName = String();
+    _itemFilename = String();
+    _itemType = String();
+  }
+
+  uint8_t* end = data + len;
+
+  while (data < end)
+  {
+    if (_multiParseState == PARSE_ITEM_DATA)
+    {
+      size_t used = _parseMultipartData(data, end - data);
+
+      _parsedLength += used;
+      data += used;
+    }
+    else if (_multiParseState == PARSE_HEADERS)
+    {
+      uint8_t* eol = (uint8_t*) memchr(data, '\n', end - data);
+      uint8_t* stop = (eol ? eol : end);
+
+      _temp.reserve(_temp.length() + (stop - data));
+
+      for (uint8_t* p = data; p < stop; p++)
+      {
+        if (*p != '\r')
+          _temp += (char) *p;
+      }
+
+      _parsedLength += stop - data;
+      data = stop;
+
+      if (eol)
+      {
+        _parsedLength++;
+        data++;
+
+        if (_temp.length())
+          _parseMultipartHeader();
+        else
+          _startMultipartItem();
+      }
+    }
+    else if (_multiParseState == PARSING_FINISHED || _multiParseState == PARSE_ERROR)
+    {
+      _parsedLength += end - data;
+      data = end;
+    }
+    else
+    {
+      _parseMultipartPostByte(*data++);
+      _parsedLength++;
     }
   }
+
+  // Hand the data of this segment to the upload handler, as the byte parser did
+  if (_multiParseState == PARSE_ITEM_DATA && _itemIsFile)
+    _flushUpload();
 }
 
 /////////////////////////////////////////////////
 
 void AsyncWebServerRequest::_parseLine()
 {
+  // Trim the line in place and terminate it, _appendHead() always leaves room for the NUL
+  size_t start = _lineStart;
+  size_t end = _headLength;
+
+  while (end > start && isspace((unsigned char) _head[end - 1]))
+    end--;
+
+  while (start < end && isspace((unsigned char) _head[start]))
+    start++;
+
+  _head[end] = 0;
+  _headLength = end + 1;
+  _lineStart = start;
+
+  const bool empty = (start == end);
+
   if (_parseState == PARSE_REQ_START)
   {
-    if (!_temp.length())
+    if (empty)
     {
+      // Ignore the empty line some clients send after the body of the previous request on a kept-alive connection
+      if (_requestCount)
+      {
+        _headLength = _lineStart = 0;
+
+        return;
+      }
+
       _parseState = PARSE_REQ_FAIL;
       _client->close();
     }
@@ -926,16 +1612,25 @@ void AsyncWebServerRequest::_parseLine()
       _parseState = PARSE_REQ_HEADERS;
     }
 
+    _lineStart = _headLength;
+
     return;
   }
 
   if (_parseState == PARSE_REQ_HEADERS)
   {
-    if (!_temp.length())
+    if (empty)
     {
       //end of headers
-      _server->_rewriteRequest(this);
-      _server->_attachHandler(this);
+      _keepAlive = _keepAlive && _server->_keepAlive && (_requestCount < _server->_keepAliveMaxRequests);
+
+      // No handler for unknown methods, they're answered with 501 once the body is skipped
+      if (_method != HTTP_UNKNOWN)
+      {
+        _server->_rewriteRequest(this);
+        _server->_attachHandler(this);
+      }
+
       _removeNotInterestingHeaders();
 
       if (_expectingContinue)
@@ -961,7 +1656,10 @@ void AsyncWebServerRequest::_parseLine()
       }
     }
     else
+    {
       _parseReqHeader();
+      _lineStart = _headLength;
+    }
   }
 }
 
@@ -969,52 +1667,320 @@ void AsyncWebServerRequest::_parseLine()
 
 size_t AsyncWebServerRequest::headers() const
 {
-  return _headers.length();
+  return _headerCount;
 }
 
 /////////////////////////////////////////////////
 
-bool AsyncWebServerRequest::hasHeader(const String& name) const
+// Names of the well-known headers and their length, indexed by WebHeaderId
+struct WebHeaderName
+{
+  const char* name;
+  uint8_t     length;
+};
+
+#define WEB_HEADER(name)    { name, sizeof(name) - 1 }
+
+static const WebHeaderName webHeaderNames[HEADER_MAX] =
+{
+  WEB_HEADER("Host"),
+  WEB_HEADER("Connection"),
+  WEB_HEADER("Content-Type"),
+  WEB_HEADER("Content-Length"),
+  WEB_HEADER("Expect"),
+  WEB_HEADER("Authorization"),
+  WEB_HEADER("Upgrade"),
+  WEB_HEADER("Origin"),
+  WEB_HEADER("Sec-WebSocket-Key"),
+  WEB_HEADER("Sec-WebSocket-Version"),
+  WEB_HEADER("Sec-WebSocket-Protocol"),
+  WEB_HEADER("Sec-WebSocket-Extensions"),
+  WEB_HEADER("Accept"),
+  WEB_HEADER("Accept-Encoding"),
+  WEB_HEADER("Accept-Language"),
+  WEB_HEADER("Cache-Control"),
+  WEB_HEADER("Cookie"),
+  WEB_HEADER("If-None-Match"),
+  WEB_HEADER("If-Modified-Since"),
+  WEB_HEADER("If-Range"),
+  WEB_HEADER("Range"),
+  WEB_HEADER("Last-Event-ID"),
+  WEB_HEADER("Referer"),
+  WEB_HEADER("User-Agent"),
+};
+
+#undef WEB_HEADER
+
+// Longest well-known header name, "Sec-WebSocket-Extensions"
+#define WEB_HEADER_NAME_MAX     24
+
+// Well-known headers chained by name length, so that a name is only compared to the few of its length
+struct WebHeaderLengthIndex
 {
-  for (const auto& h : _headers)
+  uint8_t first[WEB_HEADER_NAME_MAX + 1];     // first id of each length, HEADER_MAX if none
+  uint8_t next[HEADER_MAX];                   // next id of the same length, HEADER_MAX at the end
+
+  WebHeaderLengthIndex()
   {
-    if (h->name().equalsIgnoreCase(name))
+    memset(first, HEADER_MAX, sizeof(first));
+
+    for (uint8_t id = HEADER_MAX; id > 0; id--)
     {
-      return true;
+      const uint8_t len = webHeaderNames[id - 1].length;
+
+      // A longer name added to the table must raise WEB_HEADER_NAME_MAX
+      if (len > WEB_HEADER_NAME_MAX)
+        continue;
+
+      next[id - 1] = first[len];
+      first[len] = id - 1;
     }
   }
+};
 
-  return false;
+static const WebHeaderLengthIndex webHeaderLengthIndex;
+
+/////////////////////////////////////////////////
+
+const char * webHeaderName(WebHeaderId id)
+{
+  return (id < HEADER_MAX ? webHeaderNames[id].name : "");
 }
 
 /////////////////////////////////////////////////
 
-AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const
+// Returns HEADER_MAX if name isn't a well-known header. At most 4 names have the same length, rejected on
+// their first char before the full compare
+WebHeaderId webHeaderId(const char* name, size_t len)
+{
+  if (len == 0 || len > WEB_HEADER_NAME_MAX)
+    return HEADER_MAX;
+
+  const int first = tolower(name[0]);
+
+  for (uint8_t id = webHeaderLengthIndex.first[len]; id != HEADER_MAX; id = webHeaderLengthIndex.next[id])
+  {
+    const char* known = webHeaderNames[id].name;
+
+    if (tolower(known[0]) == first && !strncasecmp(known, name, len))
+      return (WebHeaderId) id;
+  }
+
+  return HEADER_MAX;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::_indexHeaders()
+{
+  memset(_headerIndex, 0, sizeof(_headerIndex));
+
+  for (uint8_t i = _headerCount; i > 0; i--)
+  {
+    if (_headers[i - 1].id != HEADER_MAX)
+      _headerIndex[_headers[i - 1].id] = i;
+  }
+}
+
+/////////////////////////////////////////////////
+
+int AsyncWebServerRequest::_findHeader(const char* name) const
 {
-  for (const auto& h : _headers)
+  const size_t len = strlen(name);
+  const WebHeaderId id = webHeaderId(name, len);
+
+  if (id != HEADER_MAX)
+    return (int) _headerIndex[id] - 1;
+
+  for (uint8_t i = 0; i < _headerCount; i++)
   {
-    if (h->name().equalsIgnoreCase(name))
+    if (_headers[i].id == HEADER_MAX && _headers[i].nameLength == len && !strcasecmp(_head + _headers[i].name, name))
     {
-      return h;
+      return i;
     }
   }
 
-  return nullptr;
+  return -1;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebHeader* AsyncWebServerRequest::_headerObject(size_t i) const
+{
+  AsyncWebHeaderSlice& header = _headers[i];
+
+  if (header.object == NULL)
+  {
+    header.object = new AsyncWebHeader(String(_head + header.name), String(_head + header.value));
+  }
+
+  return header.object;
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const
+{
+  return (_findHeader(name.c_str()) >= 0);
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const
+{
+  int i = _findHeader(name.c_str());
+
+  return (i >= 0 ? _headerObject(i) : nullptr);
 }
 
 /////////////////////////////////////////////////
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const
 {
-  auto header = _headers.nth(num);
+  return (num < _headerCount ? _headerObject(num) : nullptr);
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerRequest::hasHeader(WebHeaderId id) const
+{
+  return (id < HEADER_MAX && _headerIndex[id]);
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(WebHeaderId id) const
+{
+  return (hasHeader(id) ? _headerObject(_headerIndex[id] - 1) : nullptr);
+}
+
+/////////////////////////////////////////////////
+
+const char* AsyncWebServerRequest::headerValue(WebHeaderId id) const
+{
+  return (hasHeader(id) ? _head + _headers[_headerIndex[id] - 1].value : NULL);
+}
+
+/////////////////////////////////////////////////
+
+// Seconds since 1970 of an IMF-fixdate, "Sun, 06 Nov 1994 08:49:37 GMT", -1 if it isn't one
+static int64_t parseHttpDate(const char* date)
+{
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+  int day, year, hour, minute, second;
+  char month[4];
+
+  if (sscanf(date, "%*3s, %d %3s %d %d:%d:%d GMT", &day, month, &year, &hour, &minute, &second) != 6)
+    return -1;
+
+  const char* m = strstr(months, month);
+
+  if (m == NULL || (m - months) % 3)
+    return -1;
+
+  // Days from civil, March based years so that leap days end the year
+  int mon = (m - months) / 3 + 1;
+  int y = year - (mon <= 2);
+  int era = (y >= 0 ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = (int64_t) era * 146097 + doe - 719468;
+
+  return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+/////////////////////////////////////////////////
+
+// Weak comparison of an If-None-Match list of entity tags to etag
+static bool etagMatches(const char* list, const char* etag)
+{
+  if (strncmp(etag, "W/", 2) == 0)
+    etag += 2;
+
+  const size_t etagLen = strlen(etag);
+
+  while (*list)
+  {
+    while (*list == ' ' || *list == ',')
+      list++;
+
+    const char* end = list + strcspn(list, ",");
+    const char* tag = list;
+    size_t len = end - list;
+
+    while (len && tag[len - 1] == ' ')
+      len--;
+
+    if (len >= 2 && strncmp(tag, "W/", 2) == 0)
+    {
+      tag += 2;
+      len -= 2;
+    }
+
+    if ((len == 1 && *tag == '*') || (len == etagLen && memcmp(tag, etag, len) == 0))
+      return true;
+
+    list = end;
+  }
+
+  return false;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebSendBuffer& AsyncWebServerRequest::sendBuffer()
+{
+  return _server->_sendBuffer;
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebServerRequest::notModified(const char* etag, const char* lastModified) const
+{
+  const char* ifNoneMatch = headerValue(HEADER_IF_NONE_MATCH);
+
+  // If-Modified-Since is ignored when If-None-Match is sent
+  if (ifNoneMatch)
+    return (etag != NULL && etagMatches(ifNoneMatch, etag));
+
+  const char* ifModifiedSince = headerValue(HEADER_IF_MODIFIED_SINCE);
+
+  if (ifModifiedSince == NULL || lastModified == NULL)
+    return false;
+
+  const int64_t since = parseHttpDate(ifModifiedSince);
+  const int64_t modified = parseHttpDate(lastModified);
+
+  // Dates in another format are usually the Last-Modified sent back
+  if (since < 0 || modified < 0)
+    return (strcmp(ifModifiedSince, lastModified) == 0);
+
+  return (modified <= since);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServerRequest::sendNotModified(const char* etag, const char* lastModified)
+{
+  AsyncWebServerResponse* response = beginResponse(304);
+
+  if (etag)
+    response->addHeader("ETag", etag);
 
-  return (header ? *header : nullptr);
+  if (lastModified)
+    response->addHeader("Last-Modified", lastModified);
+
+  send(response);
 }
 
 /////////////////////////////////////////////////
 
 size_t AsyncWebServerRequest::params() const
 {
+  _parseGetParams();
+
   return _params.length();
 }
 
@@ -1022,6 +1988,8 @@ size_t AsyncWebServerRequest::params() const
 
 bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const
 {
+  _parseGetParams();
+
   for (const auto& p : _params)
   {
     if (p->name() == name && p->isPost() == post && p->isFile() == file)
@@ -1037,6 +2005,8 @@ bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) c
 
 AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const
 {
+  _parseGetParams();
+
   for (const auto& p : _params)
   {
     if (p->name() == name && p->isPost() == post && p->isFile() == file)
@@ -1052,6 +2022,8 @@ AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post
 
 AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const
 {
+  _parseGetParams();
+
   auto param = _params.nth(num);
 
   return (param ? *param : nullptr);
@@ -1059,8 +2031,14 @@ AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const
 
 /////////////////////////////////////////////////
 
+// Only keeps a header stored while parsing, i.e. one the interesting headers of a handler cover
 void AsyncWebServerRequest::addInterestingHeader(const String& name)
 {
+  if (!name.equalsIgnoreCase("ANY") && !(_server->_headerMask & webHeaderMask(webHeaderId(name.c_str(), name.length()))))
+  {
+    LOGDEBUG1("addInterestingHeader: not stored, no handler is interested in", name);
+  }
+
   if (!_interestingHeaders.containsIgnoreCase(name))
     _interestingHeaders.add(name);
 }
@@ -1088,6 +2066,19 @@ void AsyncWebServerRequest::send(AsyncWebServerResponse *response)
   else
   {
     _client->setRxTimeout(0);
+
+    // Rendered once into the response cache, then sent from there like to the next requests of the url
+    if (_response->_cacheTTL)
+    {
+      AsyncWebServerResponse* cached = _server->_responseCache.store(this, _response);
+
+      if (cached)
+      {
+        delete _response;
+        _response = cached;
+      }
+    }
+
     _response->_respond(this);
   }
 }
@@ -1117,6 +2108,14 @@ AsyncWebServerResponse * AsyncWebServerRequest::beginResponse(int code, const St
 {
   return new AsyncBasicResponse(code, contentType, content);
 }
+
+/////////////////////////////////////////////////
+
+AsyncWebServerResponse * AsyncWebServerRequest::beginResponseNoCopy(int code, const String& contentType,
+                                                                    const char * content)
+{
+  return new AsyncBasicResponse(code, contentType, content, true);
+}
 /////////////////////////////////////////////////
 
 AsyncWebServerResponse * AsyncWebServerRequest::beginResponse(int code, const String& contentType,
@@ -1187,6 +2186,13 @@ void AsyncWebServerRequest::send(int code, const String& contentType, const char
 
 /////////////////////////////////////////////////
 
+void AsyncWebServerRequest::sendNoCopy(int code, const String& contentType, const char *content)
+{
+  send(beginResponseNoCopy(code, contentType, content));
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServerRequest::send(int code, const String& contentType, const String& content)
 {
   send(beginResponse(code, contentType, content));
@@ -1323,6 +2329,8 @@ void AsyncWebServerRequest::requestAuthentication(const char * realm, bool isDig
 
 bool AsyncWebServerRequest::hasArg(const char* name) const
 {
+  _parseGetParams();
+
   for (const auto& arg : _params)
   {
     if (arg->name() == name)
@@ -1338,6 +2346,8 @@ bool AsyncWebServerRequest::hasArg(const char* name) const
 
 const String& AsyncWebServerRequest::arg(const String& name) const
 {
+  _parseGetParams();
+
   for (const auto& arg : _params)
   {
     if (arg->name() == name)
@@ -1367,18 +2377,107 @@ const String& AsyncWebServerRequest::argName(size_t i) const
 
 const String& AsyncWebServerRequest::pathArg(size_t i) const
 {
-  auto param = _pathParams.nth(i);
+  if (i >= _pathParamCount)
+    return SharedEmptyString;
+
+  AsyncWebPathParamSlice& param = _pathParams[i];
+
+  if (param.object == NULL)
+  {
+    const char* p = _url.c_str() + param.offset;
+
+    param.object = new String();
+    param.object->reserve(param.length);
+
+    for (uint16_t n = 0; n < param.length; n++)
+      *param.object += p[n];
+  }
+
+  return *param.object;
+}
+
+/////////////////////////////////////////////////
+
+const char* AsyncWebServerRequest::pathArgView(size_t i, size_t& len) const
+{
+  if (i >= _pathParamCount)
+  {
+    len = 0;
+
+    return NULL;
+  }
+
+  const AsyncWebPathParamSlice& param = _pathParams[i];
+
+  len = param.length;
+
+  return (param.object ? param.object->c_str() : _url.c_str() + param.offset);
+}
+
+/////////////////////////////////////////////////
+
+// Copy a path param to buf NUL terminated, false if there is no such param or it doesn't fit
+static bool pathArgCopy(const char* p, size_t len, char* buf, size_t size)
+{
+  if (p == NULL || len == 0 || len >= size)
+    return false;
+
+  memcpy(buf, p, len);
+  buf[len] = 0;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+
+long AsyncWebServerRequest::pathArgInt(size_t i, long defaultValue) const
+{
+  size_t len;
+  char buf[24];
+  char* end;
+
+  const char* p = pathArgView(i, len);
+
+  if (!pathArgCopy(p, len, buf, sizeof(buf)))
+    return defaultValue;
+
+  long value = strtol(buf, &end, 10);
+
+  return (*end == 0 ? value : defaultValue);
+}
+
+/////////////////////////////////////////////////
+
+float AsyncWebServerRequest::pathArgFloat(size_t i, float defaultValue) const
+{
+  size_t len;
+  char buf[32];
+  char* end;
+
+  const char* p = pathArgView(i, len);
 
-  return (param ? **param : SharedEmptyString);
+  if (!pathArgCopy(p, len, buf, sizeof(buf)))
+    return defaultValue;
+
+  float value = strtod(buf, &end);
+
+  return (*end == 0 ? value : defaultValue);
 }
 
 /////////////////////////////////////////////////
 
 const String& AsyncWebServerRequest::header(const char* name) const
 {
-  AsyncWebHeader* h = getHeader(String(name));
+  int i = _findHeader(name);
+
+  return (i >= 0 ? _headerObject(i)->value() : SharedEmptyString);
+}
 
-  return (h ? h->value() : SharedEmptyString);
+/////////////////////////////////////////////////
+
+const String& AsyncWebServerRequest::header(WebHeaderId id) const
+{
+  return (hasHeader(id) ? _headerObject(_headerIndex[id] - 1)->value() : SharedEmptyString);
 }
 
 /////////////////////////////////////////////////
@@ -1403,35 +2502,77 @@ const String& AsyncWebServerRequest::headerName(size_t i) const
 
 String AsyncWebServerRequest::urlDecode(const String& text) const
 {
-  char temp[] = "0x00";
-  unsigned int len = text.length();
-  unsigned int i = 0;
-  String decoded = String();
-  decoded.reserve(len); // Allocate the string internal buffer - never longer from source text
+  return _urlDecode(text.c_str(), text.length());
+}
+
+/////////////////////////////////////////////////
+
+// Value of the hex digits, 0xFF for the other chars
+static const uint8_t hexValues[128] =
+{
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0,    1,    2,    3,    4,    5,    6,    7,    8,    9, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF,   10,   11,   12,   13,   14,   15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF,   10,   11,   12,   13,   14,   15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/////////////////////////////////////////////////
+
+// Decodes len chars of src into dst, which can be src itself, and returns the decoded length
+static size_t urlDecodeTo(char* dst, const char* src, size_t len)
+{
+  const char* end = src + len;
+  char* out = dst;
 
-  while (i < len)
+  while (src < end)
   {
-    char decodedChar;
-    char encodedChar = text.charAt(i++);
+    char c = *src++;
 
-    if ((encodedChar == '%') && (i + 1 < len))
+    if (c == '+')
     {
-      temp[2] = text.charAt(i++);
-      temp[3] = text.charAt(i++);
-      decodedChar = strtol(temp, NULL, 16);
+      c = ' ';
     }
-    else if (encodedChar == '+')
+    else if (c == '%' && end - src >= 2)
     {
-      decodedChar = ' ';
-    }
-    else
-    {
-      decodedChar = encodedChar;  // normal ascii char
+      const uint8_t hi = hexValues[src[0] & 0x7F] | (src[0] & 0x80);
+      const uint8_t lo = hexValues[src[1] & 0x7F] | (src[1] & 0x80);
+
+      // Invalid escapes are kept as they are
+      if (hi < 16 && lo < 16)
+      {
+        c = (char) ((hi << 4) | lo);
+        src += 2;
+      }
     }
 
-    decoded.concat(decodedChar);
+    *out++ = c;
   }
 
+  return out - dst;
+}
+
+/////////////////////////////////////////////////
+
+String AsyncWebServerRequest::_urlDecode(const char* text, size_t len)
+{
+  // Short texts, most names and values, are decoded on the stack and copied once into the String
+  char stackBuffer[64];
+  char* buffer = (len < sizeof(stackBuffer) ? stackBuffer : (char*) malloc(len + 1));
+
+  if (buffer == NULL)
+    return String();
+
+  buffer[urlDecodeTo(buffer, text, len)] = 0;
+
+  String decoded(buffer);
+
+  if (buffer != stackBuffer)
+    free(buffer);
+
   return decoded;
 }
 
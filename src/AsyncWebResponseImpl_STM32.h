@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #pragma once
@@ -61,18 +62,24 @@ class AsyncBasicResponse: public AsyncWebServerResponse
   private:
     String _content;
 
-    char *_contentCstr;      // RSMOD
-    String _partialHeader;
+    char *_contentCstr;      // RSMOD, caller owned, queued in place
+    bool _noCopy;            // _contentCstr referenced by lwIP until acknowledged instead of copied
+    String _head;
+    size_t _headOffset;      // bytes of _head already queued
+
+    size_t _queue(AsyncWebServerRequest *request);
 
   public:
     AsyncBasicResponse(int code, const String& contentType = String(), const String& content = String());
 
-    AsyncBasicResponse(int code, const String& contentType, const char *content = nullptr);     // RSMOD
+    AsyncBasicResponse(int code, const String& contentType, const char *content = nullptr, bool noCopy = false);     // RSMOD
 
     void _respond(AsyncWebServerRequest *request);
 
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 
+    virtual bool _renderContent(uint8_t *data, size_t len) override;
+
     /////////////////////////////////////////////////
 
     inline bool _sourceValid() const
@@ -89,6 +96,7 @@ class AsyncAbstractResponse: public AsyncWebServerResponse
 {
   private:
     String _head;
+    size_t _headOffset;         // bytes of _head already queued
     // Data is inserted into cache at begin().
     // This is inefficient with vector, but if we use some other container,
     // we won't be able to access it as contiguous array of bytes when reading from it,
@@ -96,15 +104,37 @@ class AsyncAbstractResponse: public AsyncWebServerResponse
     std::vector<uint8_t> _cache;
     size_t _readDataFromCacheOrContent(uint8_t* data, const size_t len);
     size_t _fillBufferAndProcessTemplates(uint8_t* buf, size_t maxLen);
+    bool _ifRangeMatches(const char* ifRange) const;
+    void _applyRange(AsyncWebServerRequest *request);
+    size_t _addContent(AsyncWebServerRequest *request, size_t space);
 
   protected:
     AwsTemplateProcessor _callback;
 
+    // Skip offset bytes of the content, for responses setting _acceptRanges or having _directContent()
+    virtual void _seek(size_t offset __attribute__((unused))) {}
+
+    // Next content byte if the content is in memory or flash, queued from there instead of filled into a send buffer.
+    // NULL to use _fillBuffer()
+    virtual const uint8_t* _directContent()
+    {
+      return NULL;
+    }
+
+    // apiflags of the _directContent() add(): copied by lwIP by default, as RAM may change before it is acknowledged
+    virtual uint8_t _directWriteFlags()
+    {
+      return ASYNC_WRITE_FLAG_COPY;
+    }
+
   public:
     AsyncAbstractResponse(AwsTemplateProcessor callback = nullptr);
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 
+    // Only content in memory or flash, fillers may not have it all at once
+    virtual bool _renderContent(uint8_t *data, size_t len) override;
+
     /////////////////////////////////////////////////
 
     inline bool _sourceValid() const
@@ -174,6 +204,9 @@ class AsyncCallbackResponse: public AsyncAbstractResponse
     /////////////////////////////////////////////////
 
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+
+  protected:
+    virtual void _seek(size_t offset) override;
 };
 
 /////////////////////////////////////////////////
@@ -227,6 +260,10 @@ class AsyncMemResponse: public AsyncAbstractResponse
     /////////////////////////////////////////////////
 
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+
+  protected:
+    virtual void _seek(size_t offset) override;
+    virtual const uint8_t* _directContent() override;
 };
 
 /////////////////////////////////////////////////
@@ -251,6 +288,62 @@ class AsyncProgmemResponse: public AsyncAbstractResponse
     /////////////////////////////////////////////////
 
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+
+  protected:
+    virtual void _seek(size_t offset) override;
+    virtual const uint8_t* _directContent() override;
+
+    /////////////////////////////////////////////////
+
+    // Content in flash is referenced without copy. beginResponse_P() is also used with RAM arrays, which are copied
+    virtual uint8_t _directWriteFlags() override
+    {
+#if (defined(FLASH_BASE) && defined(FLASH_END))
+
+      if (((uintptr_t) _content >= FLASH_BASE) && ((uintptr_t) _content + _contentLength <= (uintptr_t) FLASH_END + 1))
+        return 0;
+
+#endif
+
+      return ASYNC_WRITE_FLAG_COPY;
+    }
+};
+
+/////////////////////////////////////////////////
+
+// Entry of the response cache, sent with the Connection line of the request
+class AsyncCachedResponse: public AsyncWebServerResponse
+{
+  private:
+    AsyncWebResponseCache* _cache;
+    int _entry;
+
+    size_t _queue(AsyncWebServerRequest *request);
+
+  public:
+    AsyncCachedResponse(AsyncWebResponseCache* cache, int entry);
+    ~AsyncCachedResponse();
+
+    void _respond(AsyncWebServerRequest *request);
+    size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
+
+    /////////////////////////////////////////////////
+
+    inline bool _sourceValid() const
+    {
+      return true;
+    }
+
+    /////////////////////////////////////////////////
+};
+
+/////////////////////////////////////////////////
+
+// File of a ROM filesystem, sent from flash with the header lines assembled by the generator
+class AsyncRomFileResponse: public AsyncProgmemResponse
+{
+  public:
+    AsyncRomFileResponse(const AsyncWebRomFile& file);
 };
 
 /////////////////////////////////////////////////
@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #if !defined(_ASYNCWEBSERVER_STM32_LOGLEVEL_)
@@ -67,133 +68,90 @@ void* memchr(void* ptr, int ch, size_t count)
 /*
    Abstract Response
  * */
-const char* AsyncWebServerResponse::_responseCodeToString(int code)
+// Status lines without the "HTTP/1.x " prefix, sorted by code
+struct AsyncWebStatusLine
 {
-  switch (code)
-  {
-    case 100:
-      return "Continue";
-
-    case 101:
-      return "Switching Protocols";
-
-    case 200:
-      return "OK";
-
-    case 201:
-      return "Created";
-
-    case 202:
-      return "Accepted";
-
-    case 203:
-      return "Non-Authoritative Information";
-
-    case 204:
-      return "No Content";
-
-    case 205:
-      return "Reset Content";
-
-    case 206:
-      return "Partial Content";
-
-    case 300:
-      return "Multiple Choices";
-
-    case 301:
-      return "Moved Permanently";
-
-    case 302:
-      return "Found";
-
-    case 303:
-      return "See Other";
-
-    case 304:
-      return "Not Modified";
-
-    case 305:
-      return "Use Proxy";
-
-    case 307:
-      return "Temporary Redirect";
-
-    case 400:
-      return "Bad Request";
-
-    case 401:
-      return "Unauthorized";
-
-    case 402:
-      return "Payment Required";
-
-    case 403:
-      return "Forbidden";
-
-    case 404:
-      return "Not Found";
-
-    case 405:
-      return "Method Not Allowed";
-
-    case 406:
-      return "Not Acceptable";
-
-    case 407:
-      return "Proxy Authentication Required";
-
-    case 408:
-      return "Request Time-out";
-
-    case 409:
-      return "Conflict";
-
-    case 410:
-      return "Gone";
+  uint16_t    code;
+  uint8_t     length;
+  const char* line;
+};
 
-    case 411:
-      return "Length Required";
+#define STATUS_LINE(code, reason)   { code, sizeof(#code " " reason "\r\n") - 1, #code " " reason "\r\n" }
 
-    case 412:
-      return "Precondition Failed";
-
-    case 413:
-      return "Request Entity Too Large";
-
-    case 414:
-      return "Request-URI Too Large";
-
-    case 415:
-      return "Unsupported Media Type";
-
-    case 416:
-      return "Requested range not satisfiable";
-
-    case 417:
-      return "Expectation Failed";
+static const AsyncWebStatusLine statusLines[] =
+{
+  STATUS_LINE(100, "Continue"),
+  STATUS_LINE(101, "Switching Protocols"),
+  STATUS_LINE(200, "OK"),
+  STATUS_LINE(201, "Created"),
+  STATUS_LINE(202, "Accepted"),
+  STATUS_LINE(203, "Non-Authoritative Information"),
+  STATUS_LINE(204, "No Content"),
+  STATUS_LINE(205, "Reset Content"),
+  STATUS_LINE(206, "Partial Content"),
+  STATUS_LINE(300, "Multiple Choices"),
+  STATUS_LINE(301, "Moved Permanently"),
+  STATUS_LINE(302, "Found"),
+  STATUS_LINE(303, "See Other"),
+  STATUS_LINE(304, "Not Modified"),
+  STATUS_LINE(305, "Use Proxy"),
+  STATUS_LINE(307, "Temporary Redirect"),
+  STATUS_LINE(400, "Bad Request"),
+  STATUS_LINE(401, "Unauthorized"),
+  STATUS_LINE(402, "Payment Required"),
+  STATUS_LINE(403, "Forbidden"),
+  STATUS_LINE(404, "Not Found"),
+  STATUS_LINE(405, "Method Not Allowed"),
+  STATUS_LINE(406, "Not Acceptable"),
+  STATUS_LINE(407, "Proxy Authentication Required"),
+  STATUS_LINE(408, "Request Time-out"),
+  STATUS_LINE(409, "Conflict"),
+  STATUS_LINE(410, "Gone"),
+  STATUS_LINE(411, "Length Required"),
+  STATUS_LINE(412, "Precondition Failed"),
+  STATUS_LINE(413, "Request Entity Too Large"),
+  STATUS_LINE(414, "Request-URI Too Large"),
+  STATUS_LINE(415, "Unsupported Media Type"),
+  STATUS_LINE(416, "Requested range not satisfiable"),
+  STATUS_LINE(417, "Expectation Failed"),
+  STATUS_LINE(431, "Request Header Fields Too Large"),
+  STATUS_LINE(500, "Internal Server Error"),
+  STATUS_LINE(501, "Not Implemented"),
+  STATUS_LINE(502, "Bad Gateway"),
+  STATUS_LINE(503, "Service Unavailable"),
+  STATUS_LINE(504, "Gateway Time-out"),
+  STATUS_LINE(505, "HTTP Version not supported"),
+};
+
+#undef STATUS_LINE
 
-    case 500:
-      return "Internal Server Error";
+/////////////////////////////////////////////////
 
-    case 501:
-      return "Not Implemented";
+// "404 Not Found\r\n" and its length, codes without reason phrase being formatted as "299 \r\n" into buf
+const char* AsyncWebServerResponse::_statusLine(int code, StatusLineBuffer& buf, size_t& len)
+{
+  size_t low = 0;
+  size_t high = sizeof(statusLines) / sizeof(statusLines[0]);
 
-    case 502:
-      return "Bad Gateway";
+  while (low < high)
+  {
+    const size_t mid = (low + high) / 2;
 
-    case 503:
-      return "Service Unavailable";
+    if (statusLines[mid].code == code)
+    {
+      len = statusLines[mid].length;
 
-    case 504:
-      return "Gateway Time-out";
+      return statusLines[mid].line;
+    }
+    else if (statusLines[mid].code < code)
+      low = mid + 1;
+    else
+      high = mid;
+  }
 
-    case 505:
-      return "HTTP Version not supported";
+  len = snprintf(buf, sizeof(buf), "%d \r\n", code);
 
-    default:
-      return "";
-  }
+  return buf;
 }
 
 /////////////////////////////////////////////////
@@ -204,8 +162,10 @@ AsyncWebServerResponse::AsyncWebServerResponse()
 {
   delete h;
 }))
-, _contentType(), _contentLength(0), _sendContentLength(true), _chunked(false), _headLength(0)
-, _sentLength(0), _ackedLength(0), _writtenLength(0), _state(RESPONSE_SETUP)
+, _contentType(), _contentLength(0), _sendContentLength(true), _chunked(false), _acceptRanges(false), _staticHeaders(NULL)
+, _headLength(0)
+, _sentLength(0), _ackedLength(0), _writtenLength(0), _state(RESPONSE_SETUP), _keepAlive(false)
+, _cacheTTL(0)
 {
   for (auto header : DefaultHeaders::Instance())
   {
@@ -246,6 +206,14 @@ void AsyncWebServerResponse::setContentType(const String& type)
 
 /////////////////////////////////////////////////
 
+void AsyncWebServerResponse::setCacheable(uint32_t ttl)
+{
+  if (_state == RESPONSE_SETUP)
+    _cacheTTL = ttl;
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServerResponse::addHeader(const String& name, const String& value)
 {
   _headers.add(new AsyncWebHeader(name, value));
@@ -253,43 +221,113 @@ void AsyncWebServerResponse::addHeader(const String& name, const String& value)
 
 /////////////////////////////////////////////////
 
-String AsyncWebServerResponse::_assembleHead(uint8_t version)
+void AsyncWebServerResponse::_addConnectionHeader(AsyncWebServerRequest *request)
+{
+  // The connection can only be reused if the client is able to tell where the body ends
+  _keepAlive = request->keepAlive() && (_sendContentLength || (_chunked && request->version()));
+
+  addHeader("Connection", _keepAlive ? "keep-alive" : "close");
+}
+
+/////////////////////////////////////////////////
+
+// Exact length of the head returned by _assembleHead(version)
+size_t AsyncWebServerResponse::_headSize(uint8_t version) const
 {
+  StatusLineBuffer statusBuf;
+  size_t statusLength;
+
+  _statusLine(_code, statusBuf, statusLength);
+
+  char buf[12];
+  size_t len = sizeof("HTTP/1.x ") - 1 + statusLength;
+
+  // A 304 has no body, its Content-Length would be the one of the cached copy
+  if (_sendContentLength && _code != 304)
+    len += sizeof("Content-Length: \r\n") - 1 + strlen(ultoa(_contentLength, buf, 10));
+
+  if (_contentType.length())
+    len += sizeof("Content-Type: \r\n") - 1 + _contentType.length();
+
+  for (const auto& header : _headers)
+    len += header->name().length() + sizeof(": \r\n") - 1 + header->value().length();
+
   if (version)
   {
-    addHeader("Accept-Ranges", "none");
+    len += _acceptRanges ? sizeof("Accept-Ranges: bytes\r\n") - 1 : sizeof("Accept-Ranges: none\r\n") - 1;
 
     if (_chunked)
-      addHeader("Transfer-Encoding", "chunked");
+      len += sizeof("Transfer-Encoding: chunked\r\n") - 1;
   }
 
-  String out = String();
-  int bufSize = 300;
-  char buf[bufSize];
+  // Header lines assembled beforehand, e.g. by the ROM filesystem generator
+  if (_staticHeaders)
+    len += strlen(_staticHeaders);
+
+  return len + 2;
+}
 
-  snprintf(buf, bufSize, "HTTP/1.%d %d %s\r\n", version, _code, _responseCodeToString(_code));
-  out.concat(buf);
+/////////////////////////////////////////////////
+
+String AsyncWebServerResponse::_assembleHead(uint8_t version)
+{
+  // Sized first, so that the head is allocated once and appended without reallocating
+  const size_t len = _headSize(version);
+  String out;
 
-  if (_sendContentLength)
+  if (!out.reserve(len))
   {
-    snprintf(buf, bufSize, "Content-Length: %d\r\n", _contentLength);
-    out.concat(buf);
+    LOGDEBUG1("AsyncWebServerResponse::_assembleHead reserve failed, len =", len);
+
+    _headLength = 0;
+
+    return out;
+  }
+
+  StatusLineBuffer statusBuf;
+  size_t statusLength;
+  const char* status = _statusLine(_code, statusBuf, statusLength);
+
+  out.concat(version ? "HTTP/1.1 " : "HTTP/1.0 ");
+  out.concat(status);
+
+  if (_sendContentLength && _code != 304)
+  {
+    char lengthBuf[12];
+
+    out.concat("Content-Length: ");
+    out.concat(ultoa(_contentLength, lengthBuf, 10));
+    out.concat("\r\n");
   }
 
   if (_contentType.length())
   {
-    snprintf(buf, bufSize, "Content-Type: %s\r\n", _contentType.c_str());
-    out.concat(buf);
+    out.concat("Content-Type: ");
+    out.concat(_contentType);
+    out.concat("\r\n");
   }
 
   for (const auto& header : _headers)
   {
-    snprintf(buf, bufSize, "%s: %s\r\n", header->name().c_str(), header->value().c_str());
-    out.concat(buf);
+    out.concat(header->name());
+    out.concat(": ");
+    out.concat(header->value());
+    out.concat("\r\n");
   }
 
   _headers.free();
 
+  if (version)
+  {
+    out.concat(_acceptRanges ? "Accept-Ranges: bytes\r\n" : "Accept-Ranges: none\r\n");
+
+    if (_chunked)
+      out.concat("Transfer-Encoding: chunked\r\n");
+  }
+
+  if (_staticHeaders)
+    out.concat(_staticHeaders);
+
   out.concat("\r\n");
   _headLength = out.length();
 
@@ -326,6 +364,16 @@ bool AsyncWebServerResponse::_sourceValid() const
 
 /////////////////////////////////////////////////
 
+bool AsyncWebServerResponse::_renderContent(uint8_t *data, size_t len)
+{
+  AWS_STM32_UNUSED(data);
+  AWS_STM32_UNUSED(len);
+
+  return false;
+}
+
+/////////////////////////////////////////////////
+
 void AsyncWebServerResponse::_respond(AsyncWebServerRequest *request)
 {
   _state = RESPONSE_END;
@@ -349,25 +397,24 @@ size_t AsyncWebServerResponse::_ack(AsyncWebServerRequest *request, size_t len,
 /*
    String/Code Response
  * */
-AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, const char *content)
+AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, const char *content, bool noCopy)
 {
   _code = code;
   _content = String("");
   _contentCstr = (char *)content;    // RSMOD
+  _noCopy = noCopy;
   _contentType = contentType;
-  _partialHeader = String();
+  _headOffset = 0;
 
-  int iLen;
+  size_t iLen;
 
-  if ((iLen = strlen(_contentCstr)))
+  if (_contentCstr && (iLen = strlen(_contentCstr)))
   {
     _contentLength = iLen;
 
     if (!_contentType.length())
       _contentType = "text/plain";
   }
-
-  addHeader("Connection", "close");
 }
 
 /////////////////////////////////////////////////
@@ -381,9 +428,10 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
   _content = content;
 
   _contentCstr = nullptr;        // RSMOD
+  _noCopy = false;
 
   _contentType = contentType;
-  _partialHeader = String();
+  _headOffset = 0;
 
   if (_content.length())
   {
@@ -392,269 +440,289 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
     if (!_contentType.length())
       _contentType = "text/plain";
   }
-
-  addHeader("Connection", "close");
 }
 
 /////////////////////////////////////////////////
 
 void AsyncBasicResponse::_respond(AsyncWebServerRequest *request)
 {
-  _state = RESPONSE_HEADERS;
-  String out = _assembleHead(request->version());
-  size_t outLen = out.length();
-  size_t space = request->client()->space();
+  _addConnectionHeader(request);
 
-  LOGDEBUG3("AsyncBasicResponse::_respond : Pre_respond, _contentLength =", _contentLength, ", out =", out );
-  LOGDEBUG3("outLen =", outLen, ", _contentCstr =", _contentCstr);
+  // The body is queued from _content or the caller's string, only the head being built
+  _head = _assembleHead(request->version());
+  _state = RESPONSE_CONTENT;
 
-  if (!_contentLength && space >= outLen)
-  {
-    LOGDEBUG("Step 1");
+  _queue(request);
 
-    _writtenLength += request->client()->write(out.c_str(), outLen);
-    _state = RESPONSE_WAIT_ACK;
-  }
-  else if (_contentLength && space >= outLen + _contentLength)
-  {
-    LOGDEBUG("Step 2");
+  LOGDEBUG3("AsyncBasicResponse::_respond : _contentLength =", _contentLength, ", _sentLength =", _sentLength);
+}
 
-    if (_contentCstr)
-    {
-      _content = String(
-                   _contentCstr);    // short _contentCstr - so just send as Arduino String - not much of a penalty - fall into below
-    }
+/////////////////////////////////////////////////
 
-    out += _content;
-    outLen += _contentLength;
-    _writtenLength += request->client()->write(out.c_str(), outLen);
+// Queue what fits of the rest of the head, copied as it is freed once queued, then of the body from
+// _sentLength on. Returns the number of bytes queued
+size_t AsyncBasicResponse::_queue(AsyncWebServerRequest *request)
+{
+  AsyncClient* client = request->client();
+  size_t space = client->space();
+  size_t queued = 0;
 
-    _state = RESPONSE_WAIT_ACK;
-  }
-  else if (space && space < outLen)
+  if (_headOffset < _head.length())
   {
-    String partial = out.substring(0, space);
+    size_t headLen = std::min(space, _head.length() - _headOffset);
 
-    LOGDEBUG("Step 3");
+    headLen = client->add(_head.c_str() + _headOffset, headLen);
+    _headOffset += headLen;
+    queued += headLen;
+    space -= headLen;
 
-    if (_contentCstr)
+    if (_headOffset == _head.length())
     {
-      _partialHeader = out.substring(space);
-    }
-    else
-    {
-      _content = out.substring(space) + _content;
-      _contentLength += outLen - space;
+      _head = String();
+      _headOffset = 0;
     }
+  }
 
-    LOGDEBUG1("partial =", partial);
+  if (!_head.length() && space && _sentLength < _contentLength)
+  {
+    size_t bodyLen = std::min(space, _contentLength - _sentLength);
 
-    _writtenLength += request->client()->write(partial.c_str(), partial.length());
+    if (_contentCstr)
+      bodyLen = client->add(_contentCstr + _sentLength, bodyLen, _noCopy ? 0 : ASYNC_WRITE_FLAG_COPY);
+    else
+      bodyLen = client->add(_content.c_str() + _sentLength, bodyLen);
 
-    _state = RESPONSE_CONTENT;
+    _sentLength += bodyLen;
+    queued += bodyLen;
   }
-  else if (space > outLen && space < (outLen + _contentLength))
+
+  if (queued)
   {
-    size_t shift = space - outLen;
+    _writtenLength += queued;
+    client->send();
+  }
 
-    LOGDEBUG("Step 4");
+  if (!_head.length() && _sentLength == _contentLength)
+    _state = RESPONSE_WAIT_ACK;
 
-    outLen += shift;
-    _sentLength += shift;
+  return queued;
+}
 
-    if (_contentCstr)
-    {
-      char *s = (char *)malloc(shift + 1);
+/////////////////////////////////////////////////
 
-      if (s != nullptr)
-      {
-        strncpy(s, _contentCstr, shift);
-        s[shift] = '\0';
-        out += String(s);
-        _contentCstr += shift;
+size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time)
+{
+  AWS_STM32_UNUSED(time);
 
-        free(s);
-      }
-      else
-      {
-        LOGERROR("AsyncBasicResponse::_respond: Out of heap");
+  _ackedLength += len;
 
-        return;
-      }
-    }
-    else
+  if (_state == RESPONSE_CONTENT)
+  {
+    return _queue(request);
+  }
+  else if (_state == RESPONSE_WAIT_ACK)
+  {
+    if (_ackedLength >= _writtenLength)
     {
-      out += _content.substring(0, shift);
-      _content = _content.substring(shift);
+      _state = RESPONSE_END;
     }
+  }
 
-    LOGDEBUG1("out =", out);
+  LOGDEBUG3("AsyncBasicResponse::_ack : Post_ack, _contentLength =", _contentLength, ", _writtenLength =", _writtenLength);
 
-    _writtenLength += request->client()->write(out.c_str(), outLen);
-    _state = RESPONSE_CONTENT;
-  }
-  else
-  {
-    LOGDEBUG("Step 5");
+  return 0;
+}
 
-    if (_contentCstr)
-    {
-      _partialHeader = out;
-    }
-    else
-    {
-      _content = out + _content;
-      _contentLength += outLen;
-    }
+/////////////////////////////////////////////////
 
-    _state = RESPONSE_CONTENT;
-  }
+bool AsyncBasicResponse::_renderContent(uint8_t *data, size_t len)
+{
+  memcpy(data, _contentCstr ? _contentCstr : _content.c_str(), len);
 
-  LOGDEBUG3("AsyncBasicResponse::_respond : Post_respond, _contentLength =", _contentLength, ", out =", out );
-  LOGDEBUG3("outLen =", outLen, ", _contentCstr =", _contentCstr);
+  return true;
 }
 
+/////////////////////////////////////////////////
 /////////////////////////////////////////////////
 
-size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time)
+/*
+   Abstract Response
+ * */
+
+AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback)
+  : _headOffset(0), _callback(callback)
 {
-  AWS_STM32_UNUSED(time);
+  // In case of template processing, we're unable to determine real response size
+  if (callback)
+  {
+    _contentLength = 0;
+    _sendContentLength = false;
+    _chunked = true;
+  }
+}
 
-  LOGDEBUG1("AsyncBasicResponse::_ack : Pre_ack, _contentLength =", _contentLength);
 
-  _ackedLength += len;
+/////////////////////////////////////////////////
 
-  if (_state == RESPONSE_CONTENT)
+// Compare If-Range to the ETag or Last-Modified of the response, strong comparison
+bool AsyncAbstractResponse::_ifRangeMatches(const char* ifRange) const
+{
+  if (strncmp(ifRange, "W/", 2) == 0)
+    return false;
+
+  const char* name = (ifRange[0] == '"') ? "ETag" : "Last-Modified";
+
+  for (const auto& header : _headers)
   {
-    String out;
-    size_t available = _contentLength - _sentLength;
-    size_t space = request->client()->space();
+    if (header->name().equalsIgnoreCase(name))
+      return header->value().equals(ifRange);
+  }
 
-    if (_partialHeader.length() > 0)
-    {
-      if (_partialHeader.length() > space)
-      {
-        // Header longer than space - send a piece of it, and make the _partialHeader = to what remains
-        String _subHeader;
-        String tmpString;
+  // Header lines assembled beforehand, "Name: value\r\n"
+  const size_t nameLen = strlen(name);
+  const char* line = _staticHeaders;
 
-        _subHeader = _partialHeader.substring(0, space);
-        tmpString = _partialHeader.substring(space);
-        _partialHeader = tmpString;
+  while (line && *line)
+  {
+    const char* end = strstr(line, "\r\n");
 
-        _writtenLength += request->client()->write(_subHeader.c_str(), space);
+    if (end == NULL)
+      break;
 
-        return (_partialHeader.length());
-      }
-      else
-      {
-        // _partialHeader is <= space length - therefore send the whole thing, and make the remaining length = to the _contrentLength
-        _writtenLength += request->client()->write(_partialHeader.c_str(), _partialHeader.length());
+    if (strncasecmp(line, name, nameLen) == 0 && line[nameLen] == ':')
+    {
+      const char* value = line + nameLen + 1;
 
-        _partialHeader = String();
+      while (*value == ' ')
+        value++;
 
-        return (_contentLength);
-      }
+      return ((size_t) (end - value) == strlen(ifRange) && memcmp(value, ifRange, end - value) == 0);
     }
 
-    // if we are here - there is no _partialHJeader to send
+    line = end + 2;
+  }
 
-    LOGDEBUG3("AsyncBasicResponse::_ack : available =", available, ", space =", space );
+  return false;
+}
 
-    //we can fit in this packet
-    if (space > available)
-    {
-      LOGDEBUG1("AsyncBasicResponse::_ack : Pre_ack, _contentLength =", _contentLength);
+/////////////////////////////////////////////////
 
-      if (_contentCstr)
-      {
-        LOGDEBUG1("In space>available : output =", _contentCstr);
+// Answer "Range: bytes=first-last", "bytes=first-" or "bytes=-suffix" with 206 and that part of the content,
+// or 416 if it's beyond the content. Other Range headers are ignored, the whole content being sent
+void AsyncAbstractResponse::_applyRange(AsyncWebServerRequest *request)
+{
+  const char* range = request->headerValue(HEADER_RANGE);
 
-        _writtenLength += request->client()->write(_contentCstr, available);
-        //_contentCstr[0] = '\0';
-      }
-      else
-      {
-        _writtenLength += request->client()->write(_content.c_str(), available);
-        _content = String();
-      }
+  if (!_acceptRanges || range == NULL || _code != 200 || _chunked || !_sendContentLength
+      || request->method() != HTTP_GET || strncasecmp(range, "bytes=", 6))
+  {
+    return;
+  }
 
-      _state = RESPONSE_WAIT_ACK;
+  // The range only applies to the copy the client already has
+  const char* ifRange = request->headerValue(HEADER_IF_RANGE);
 
-      return available;
-    }
+  if (ifRange && !_ifRangeMatches(ifRange))
+    return;
 
-    //send some data, the rest on ack
-    if (_contentCstr)
-    {
-      char *s = (char *)malloc(space + 1);
+  const char* spec = range + 6;
 
-      if (s != nullptr)
-      {
-        strncpy(s, _contentCstr, space);
-        s[space] = '\0';
-        out = String(s);
-        _contentCstr += space;
+  // Several ranges would need multipart/byteranges
+  if (strchr(spec, ','))
+    return;
 
-        free(s);
-      }
-      else
-      {
-        LOGERROR("AsyncBasicResponse::_ack: Out of heap");
+  const size_t total = _contentLength;
+  char* end;
+  size_t first;
+  size_t last = total - 1;
+  bool satisfiable = (total > 0);
 
-        return 0;
-      }
+  while (*spec == ' ')
+    spec++;
+
+  if (*spec == '-')
+  {
+    const size_t suffix = strtoul(spec + 1, &end, 10);
+
+    if (end == spec + 1)
+      return;
+
+    first = (total > suffix) ? total - suffix : 0;
+    satisfiable = satisfiable && (suffix > 0);
+  }
+  else
+  {
+    first = strtoul(spec, &end, 10);
+
+    if (end == spec || *end != '-')
+      return;
+
+    spec = end + 1;
+
+    if (isdigit(*spec))
+    {
+      last = strtoul(spec, &end, 10);
+
+      if (last < first)
+        return;
+
+      if (last >= total)
+        last = total - 1;
     }
     else
     {
-      out = _content.substring(0, space);
-      _content = _content.substring(space);
+      end = (char*) spec;
     }
 
-    _sentLength += space;
+    satisfiable = satisfiable && (first < total);
+  }
 
-    LOGDEBUG1("In space>available : output =", out);
+  while (*end == ' ')
+    end++;
 
-    _writtenLength += request->client()->write(out.c_str(), space);
+  if (*end)
+    return;
 
-    return space;
-  }
-  else if (_state == RESPONSE_WAIT_ACK)
+  char buf[48];
+
+  if (!satisfiable)
   {
-    if (_ackedLength >= _writtenLength)
-    {
-      _state = RESPONSE_END;
-    }
+    _code = 416;
+    _contentLength = 0;
+    snprintf(buf, sizeof(buf), "bytes */%lu", (unsigned long) total);
+    addHeader("Content-Range", buf);
+
+    return;
   }
 
-  LOGDEBUG3("AsyncBasicResponse::_ack : Post_ack, _contentLength =", _contentLength, ", _contentCstr =", _contentCstr);
+  _code = 206;
+  _contentLength = last - first + 1;
+  snprintf(buf, sizeof(buf), "bytes %lu-%lu/%lu", (unsigned long) first, (unsigned long) last, (unsigned long) total);
+  addHeader("Content-Range", buf);
 
-  return 0;
+  _seek(first);
 }
 
-/////////////////////////////////////////////////
 /////////////////////////////////////////////////
 
-/*
-   Abstract Response
- * */
-
-AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _callback(callback)
+bool AsyncAbstractResponse::_renderContent(uint8_t *data, size_t len)
 {
-  // In case of template processing, we're unable to determine real response size
-  if (callback)
-  {
-    _contentLength = 0;
-    _sendContentLength = false;
-    _chunked = true;
-  }
+  const uint8_t* content = _directContent();
+
+  if (content == NULL)
+    return false;
+
+  memcpy_P(data, content, len);
+
+  return true;
 }
 
 /////////////////////////////////////////////////
 
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request)
 {
-  addHeader("Connection", "close");
+  _applyRange(request);
+  _addConnectionHeader(request);
   _head = _assembleHead(request->version());
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
@@ -666,51 +734,89 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
 {
   (void)time;
 
+  AsyncClient* client = request->client();
+
   if (!_sourceValid())
   {
     _state = RESPONSE_FAILED;
-    request->client()->close();
+    client->close();
 
     return 0;
   }
 
   _ackedLength += len;
-  size_t space = request->client()->space();
-
-  size_t headLen = _head.length();
+  size_t space = client->space();
+  size_t written = 0;
 
   if (_state == RESPONSE_HEADERS)
   {
-    if (space >= headLen)
+    // Queued from _head as is, the content following in its own add()
+    const size_t headLen = _head.length() - _headOffset;
+    const size_t added = client->add(_head.c_str() + _headOffset, std::min(space, headLen));
+
+    _headOffset += added;
+    written += added;
+    space -= added;
+
+    if (_headOffset == _head.length())
     {
+      _head = String();
       _state = RESPONSE_CONTENT;
-      space -= headLen;
     }
-    else
+  }
+
+  if (_state == RESPONSE_CONTENT)
+  {
+    written += _addContent(request, space);
+  }
+  else if (_state == RESPONSE_WAIT_ACK)
+  {
+    if (!_sendContentLength || _ackedLength >= _writtenLength)
     {
-      String out = _head.substring(0, space);
-      _head = _head.substring(space);
-      _writtenLength += request->client()->write(out.c_str(), out.length());
+      _state = RESPONSE_END;
 
-      return out.length();
+      if (!_chunked && !_sendContentLength)
+        client->close(true);
     }
   }
 
-  if (_state == RESPONSE_CONTENT)
+  if (written)
+  {
+    client->send();
+    _writtenLength += written;
+  }
+
+  return written;
+}
+
+/////////////////////////////////////////////////
+
+// Queue up to space bytes of content. Content in memory or flash is queued straight from there with
+// _directWriteFlags(), copied by lwIP unless it's in flash and referenced until acknowledged. Other content is filled
+// into a send buffer of the server, copied by lwIP when queued, so that the buffer is given back before returning
+size_t AsyncAbstractResponse::_addContent(AsyncWebServerRequest *request, size_t space)
+{
+  AsyncClient* client = request->client();
+  const uint8_t* content = (!_callback && !_chunked) ? _directContent() : NULL;
+  uint8_t* buffer = NULL;
+  size_t added = 0;
+
+  while (_state == RESPONSE_CONTENT)
   {
     size_t outLen;
 
     if (_chunked)
     {
       if (space <= 8)
-      {
-        return 0;
-      }
+        break;
 
       outLen = space;
     }
     else if (!_sendContentLength)
     {
+      if (space == 0)
+        break;
+
       outLen = space;
     }
     else
@@ -718,101 +824,88 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
       outLen = ((_contentLength - _sentLength) > space) ? space : (_contentLength - _sentLength);
     }
 
-    uint8_t *buf = (uint8_t *)malloc(outLen + headLen);
+    size_t readLen = 0;
+    size_t queued = 0;
 
-    if (!buf)
+    if (content != NULL)
     {
-      LOGDEBUG1("AsyncAbstractResponse::_ack malloc failed, size =", outLen + headLen);
+      if (outLen)
+        queued = client->add((const char*) content, outLen, _directWriteFlags());
 
-      return 0;
+      _seek(queued);
+      content += queued;
+      readLen = outLen = queued;
     }
-
-    if (headLen)
+    else if (outLen)
     {
-      memcpy(buf, _head.c_str(), _head.length());
-    }
-
-    size_t readLen = 0;
-
-    if (_chunked)
-    {
-      // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
-      // See RFC2616 sections 2, 3.6.1.
-      readLen = _fillBufferAndProcessTemplates(buf + headLen + 6, outLen - 8);
-
-      if (readLen == RESPONSE_TRY_AGAIN)
+      if (buffer == NULL)
       {
-        free(buf);
+        buffer = request->sendBuffer().borrow();
 
-        return 0;
+        if (buffer == NULL)
+        {
+          // Retried on the next ack or poll
+          LOGDEBUG("AsyncAbstractResponse::_addContent send buffer lent");
+
+          break;
+        }
       }
 
-      outLen = sprintf((char*)buf + headLen, "%x", readLen) + headLen;
+      if (outLen > AsyncWebSendBuffer::size())
+        outLen = AsyncWebSendBuffer::size();
 
-      while (outLen < headLen + 4)
-        buf[outLen++] = ' ';
+      if (_chunked)
+      {
+        // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
+        // See RFC2616 sections 2, 3.6.1.
+        readLen = _fillBufferAndProcessTemplates(buffer + 6, outLen - 8);
 
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
-      outLen += readLen;
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
-    }
-    else
-    {
-      readLen = _fillBufferAndProcessTemplates(buf + headLen, outLen);
+        if (readLen == RESPONSE_TRY_AGAIN)
+          break;
 
-      if (readLen == RESPONSE_TRY_AGAIN)
-      {
-        free(buf);
+        outLen = sprintf((char*)buffer, "%x", readLen);
+
+        while (outLen < 4)
+          buffer[outLen++] = ' ';
 
-        return 0;
+        buffer[outLen++] = '\r';
+        buffer[outLen++] = '\n';
+        outLen += readLen;
+        buffer[outLen++] = '\r';
+        buffer[outLen++] = '\n';
       }
+      else
+      {
+        readLen = _fillBufferAndProcessTemplates(buffer, outLen);
 
-      outLen = readLen + headLen;
-    }
+        if (readLen == RESPONSE_TRY_AGAIN)
+          break;
 
-    if (headLen)
-    {
-      _head = String();
-    }
+        outLen = readLen;
+      }
 
-    if (outLen)
-    {
-      _writtenLength += request->client()->write((const char*)buf, outLen);
+      if (outLen)
+        queued = client->add((const char*) buffer, outLen);
     }
 
-    if (_chunked)
-    {
-      _sentLength += readLen;
-    }
-    else
-    {
-      _sentLength += outLen - headLen;
-    }
-
-    free(buf);
+    added += queued;
+    space -= queued;
+    _sentLength += _chunked ? readLen : queued;
 
     if ((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0) || (!_chunked && _sentLength == _contentLength))
     {
       _state = RESPONSE_WAIT_ACK;
     }
 
-    return outLen;
-
+    // Source or client without more for now
+    if (readLen == 0 || queued < outLen)
+      break;
   }
-  else if (_state == RESPONSE_WAIT_ACK)
-  {
-    if (!_sendContentLength || _ackedLength >= _writtenLength)
-    {
-      _state = RESPONSE_END;
 
-      if (!_chunked && !_sendContentLength)
-        request->client()->close(true);
-    }
-  }
+  if (buffer != NULL)
+    request->sendBuffer().giveBack(buffer);
 
-  return 0;
+  return added;
 }
 
 /////////////////////////////////////////////////
@@ -1022,6 +1115,9 @@ AsyncCallbackResponse::AsyncCallbackResponse(const String& contentType, size_t l
   if (!len)
     _sendContentLength = false;
 
+  // The callback is asked for the data from any index
+  _acceptRanges = (len && !templateCallback);
+
   _contentType = contentType;
   _filledLength = 0;
 }
@@ -1040,6 +1136,13 @@ size_t AsyncCallbackResponse::_fillBuffer(uint8_t *data, size_t len)
   return ret;
 }
 
+/////////////////////////////////////////////////
+
+void AsyncCallbackResponse::_seek(size_t offset)
+{
+  _filledLength += offset;
+}
+
 /////////////////////////////////////////////////
 /////////////////////////////////////////////////
 
@@ -1087,6 +1190,21 @@ AsyncMemResponse::AsyncMemResponse(int code, const String& contentType, const ui
   _contentType = contentType;
   _contentLength = len;
   _readLength = 0;
+  _acceptRanges = !callback;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncMemResponse::_seek(size_t offset)
+{
+  _content += offset;
+}
+
+/////////////////////////////////////////////////
+
+const uint8_t* AsyncMemResponse::_directContent()
+{
+  return _content + _readLength;
 }
 
 /////////////////////////////////////////////////
@@ -1123,6 +1241,22 @@ AsyncProgmemResponse::AsyncProgmemResponse(int code, const String& contentType,
   _contentType = contentType;
   _contentLength = len;
   _readLength = 0;
+  _acceptRanges = !callback;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncProgmemResponse::_seek(size_t offset)
+{
+  _content += offset;
+}
+
+/////////////////////////////////////////////////
+
+// Flash is memory mapped on STM32
+const uint8_t* AsyncProgmemResponse::_directContent()
+{
+  return _content + _readLength;
 }
 
 /////////////////////////////////////////////////
@@ -1148,6 +1282,160 @@ size_t AsyncProgmemResponse::_fillBuffer(uint8_t *data, size_t len)
 /////////////////////////////////////////////////
 /////////////////////////////////////////////////
 
+/*
+   Cached Response
+ * */
+
+AsyncCachedResponse::AsyncCachedResponse(AsyncWebResponseCache* cache, int entry)
+  : _cache(cache), _entry(entry)
+{
+  _code = 200;
+  _contentLength = cache->_entries[entry].bodyLength;
+  cache->_entries[entry].pins++;
+}
+
+/////////////////////////////////////////////////
+
+AsyncCachedResponse::~AsyncCachedResponse()
+{
+  _cache->_release(_entry);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncCachedResponse::_respond(AsyncWebServerRequest *request)
+{
+  // The cached head has a Content-Length, the connection can be kept alive
+  _keepAlive = request->keepAlive();
+  _state = RESPONSE_CONTENT;
+
+  _queue(request);
+}
+
+/////////////////////////////////////////////////
+
+// Queue what fits of the stored head without its final CRLF, the Connection line, then the CRLF and the body.
+// The entry can be moved within the arena between acks, it is copied by lwIP. Returns the number of bytes queued
+size_t AsyncCachedResponse::_queue(AsyncWebServerRequest *request)
+{
+  const AsyncWebResponseCache::Entry& entry = _cache->_entries[_entry];
+  const char* head = (const char*) _cache->_arena + entry.offset + entry.urlLength + 1;
+  const char* connection = _keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+
+  const char* pieces[3] = { head, connection, head + entry.headLength - 2 };
+  const size_t lengths[3] = { entry.headLength - 2, strlen(connection), 2 + entry.bodyLength };
+
+  AsyncClient* client = request->client();
+  size_t space = client->space();
+  size_t skip = _sentLength;
+  size_t queued = 0;
+
+  for (size_t i = 0; i < 3 && space; i++)
+  {
+    if (skip >= lengths[i])
+    {
+      skip -= lengths[i];
+      continue;
+    }
+
+    const size_t len = std::min(space, lengths[i] - skip);
+    const size_t added = client->add(pieces[i] + skip, len);
+
+    queued += added;
+    space -= added;
+    skip = 0;
+
+    if (added < len)
+      break;
+  }
+
+  if (queued)
+  {
+    _sentLength += queued;
+    _writtenLength += queued;
+    client->send();
+  }
+
+  if (_sentLength == lengths[0] + lengths[1] + lengths[2])
+    _state = RESPONSE_WAIT_ACK;
+
+  return queued;
+}
+
+/////////////////////////////////////////////////
+
+size_t AsyncCachedResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time)
+{
+  AWS_STM32_UNUSED(time);
+
+  _ackedLength += len;
+
+  if (_state == RESPONSE_CONTENT)
+    return _queue(request);
+
+  if (_state == RESPONSE_WAIT_ACK && _ackedLength >= _writtenLength)
+    _state = RESPONSE_END;
+
+  return 0;
+}
+
+/////////////////////////////////////////////////
+/////////////////////////////////////////////////
+
+/*
+   ROM File Response
+ * */
+
+AsyncRomFileResponse::AsyncRomFileResponse(const AsyncWebRomFile& file)
+  : AsyncProgmemResponse(200, String(), file.data, file.length)
+{
+  // Content-Type is part of the generated header lines
+  _staticHeaders = file.headers;
+}
+
+/////////////////////////////////////////////////
+
+struct AsyncWebETagEntry
+{
+  const uint8_t* content;
+  size_t         length;
+  char           etag[19];      // '"', 16 hex digits, '"'
+};
+
+static AsyncWebETagEntry etagCache[ASYNCWEBSERVER_ETAG_CACHE_SIZE];
+static size_t etagCacheNext = 0;
+
+const char* webETag_P(const uint8_t* content, size_t len)
+{
+  for (size_t i = 0; i < ASYNCWEBSERVER_ETAG_CACHE_SIZE; i++)
+  {
+    if (etagCache[i].content == content && etagCache[i].length == len)
+      return etagCache[i].etag;
+  }
+
+  // 64 bit FNV-1a, as many hex digits as the ETags of utils/romfs_gen.py
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < len; i++)
+  {
+    hash ^= pgm_read_byte(content + i);
+    hash *= 1099511628211ULL;
+  }
+
+  // Replace the oldest entry
+  AsyncWebETagEntry& entry = etagCache[etagCacheNext];
+  etagCacheNext = (etagCacheNext + 1) % ASYNCWEBSERVER_ETAG_CACHE_SIZE;
+
+  entry.content = content;
+  entry.length = len;
+  snprintf(entry.etag, sizeof(entry.etag), "\"%08lx%08lx\"", (unsigned long) (hash >> 32), (unsigned long) (hash & 0xFFFFFFFF));
+
+  return entry.etag;
+}
+
+/////////////////////////////////////////////////
+/////////////////////////////////////////////////
+
 /*
    Response Stream (You can print/write/printf to it, up to the contentLen bytes)
  * */
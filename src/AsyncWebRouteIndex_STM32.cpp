@@ -0,0 +1,570 @@
+/****************************************************************************************************************************
+  AsyncWebRouteIndex_STM32.cpp - Dead simple AsyncWebServer for STM32 LAN8720 or built-in LAN8742A Ethernet
+
+  For STM32 with LAN8720 (STM32F4/F7) or built-in LAN8742A Ethernet (Nucleo-144, DISCOVERY, etc)
+
+  AsyncWebServer_STM32 is a library for the STM32 with LAN8720 or built-in LAN8742A Ethernet WebServer
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_STM32
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+  This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+  as published bythe Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+  This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License along with this program.
+  If not, see <https://www.gnu.org/licenses/>
+
+  Version: 1.7.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.2.3   K Hoang      02/09/2020 Initial coding for STM32 for built-in Ethernet (Nucleo-144, DISCOVERY, etc).
+                                  Bump up version to v1.2.3 to sync with ESPAsyncWebServer v1.2.3
+  1.2.4   K Hoang      05/09/2020 Add back MD5/SHA1 authentication feature.
+  1.2.5   K Hoang      28/12/2020 Suppress all possible compiler warnings. Add examples.
+  1.2.6   K Hoang      22/03/2021 Fix dependency on STM32AsyncTCP Library
+  1.3.0   K Hoang      14/04/2021 Add support to LAN8720 using STM32F4 or STM32F7
+  1.3.1   K Hoang      09/10/2021 Update `platform.ini` and `library.json`
+  1.4.0   K Hoang      14/12/2021 Fix base64 encoding of websocket client key and add WebServer progmem support
+  1.4.1   K Hoang      12/01/2022 Fix authenticate issue caused by libb64
+  1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
+  1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
+  1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
+ *****************************************************************************************************************************/
+
+#if !defined(_ASYNCWEBSERVER_STM32_LOGLEVEL_)
+  #define _ASYNCWEBSERVER_STM32_LOGLEVEL_     1
+#endif
+
+#include "AsyncWebServer_Debug_STM32.h"
+
+#include "AsyncWebServer_STM32.h"
+#include "AsyncWebHandlerImpl_STM32.h"
+
+/////////////////////////////////////////////////
+
+AsyncWebRouteIndex::AsyncWebRouteIndex()
+  : _linear(NULL), _seq(0)
+{
+  memset(&_root, 0, sizeof(_root));
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRouteIndex::~AsyncWebRouteIndex()
+{
+  clear();
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::_append(Entry** list, Entry* entry)
+{
+  while (*list != NULL)
+    list = &(*list)->next;
+
+  *list = entry;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::_freeEntry(Entry* entry)
+{
+  if (entry->partial != NULL)
+    free(entry->partial);
+
+  delete entry;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRouteIndex::Node* AsyncWebRouteIndex::_addNode(Node* parent, const char* segment, size_t len, bool param)
+{
+  // All "{name}" segments share the same node, their names only matter to the handler
+  if (param)
+    len = 0;
+
+  for (Node* n = parent->child; n != NULL; n = n->next)
+  {
+    if (n->param == param && n->segmentLength == len && !memcmp(n->segment, segment, len))
+      return n;
+  }
+
+  Node* node = new Node();
+
+  if (node == NULL)
+    return NULL;
+
+  memset(node, 0, sizeof(Node));
+
+  node->segment = (char*) malloc(len + 1);
+
+  if (node->segment == NULL)
+  {
+    delete node;
+
+    return NULL;
+  }
+
+  memcpy(node->segment, segment, len);
+  node->segment[len] = 0;
+  node->segmentLength = len;
+  node->param = param;
+
+  node->next = parent->child;
+  parent->child = node;
+
+  return node;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::add(AsyncWebHandler* handler)
+{
+  Entry* entry = new Entry();
+
+  if (entry == NULL)
+    return;
+
+  entry->handler = handler;
+  entry->seq = _seq++;
+  entry->partial = NULL;
+  entry->partialLength = 0;
+  entry->exact = false;
+  entry->next = NULL;
+
+  _append(&_linear, entry);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::add(AsyncCallbackWebHandler* handler, const char* uri)
+{
+  size_t len = (uri != NULL) ? strlen(uri) : 0;
+
+  // Empty uri matches every url, regex and relative ones need canHandle()
+  if (len == 0 || uri[0] != '/')
+  {
+    add(handler);
+
+    return;
+  }
+
+  // "/path*" matches every url starting with "/path", "/path" matches "/path" and "/path/...",
+  // "/path/{id}" matches "/path/" followed by one non empty segment
+  const bool exact = handler->isTemplate();
+  const bool wildcard = !exact && (uri[len - 1] == '*');
+
+  if (wildcard)
+    len--;
+
+  const char* p = uri + 1;
+  const char* end = uri + len;
+  Node* node = &_root;
+
+  while (true)
+  {
+    const char* slash = (const char*) memchr(p, '/', end - p);
+
+    // The last segment of a wildcard uri is only a prefix of the url segment
+    if (slash == NULL && wildcard)
+      break;
+
+    const size_t segmentLength = (slash ? slash : end) - p;
+
+    node = _addNode(node, p, segmentLength, exact && AsyncCallbackWebHandler::isParamSegment(p, segmentLength));
+
+    if (node == NULL)
+    {
+      add(handler);
+
+      return;
+    }
+
+    if (slash == NULL)
+      break;
+
+    p = slash + 1;
+  }
+
+  Entry* entry = new Entry();
+
+  if (entry == NULL)
+    return;
+
+  entry->handler = handler;
+  entry->seq = _seq++;
+  entry->partial = NULL;
+  entry->partialLength = 0;
+  entry->exact = exact;
+  entry->next = NULL;
+
+  if (wildcard)
+  {
+    entry->partialLength = end - p;
+    entry->partial = (char*) malloc(entry->partialLength + 1);
+
+    if (entry->partial == NULL)
+    {
+      delete entry;
+      add(handler);
+
+      return;
+    }
+
+    memcpy(entry->partial, p, entry->partialLength);
+    entry->partial[entry->partialLength] = 0;
+  }
+
+  _append(&node->entries, entry);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::_removeEntries(Node* node, AsyncWebHandler* handler)
+{
+  for (Node* n = node->child; n != NULL; n = n->next)
+    _removeEntries(n, handler);
+
+  Entry** e = &node->entries;
+
+  while (*e != NULL)
+  {
+    if ((*e)->handler == handler)
+    {
+      Entry* entry = *e;
+      *e = entry->next;
+      _freeEntry(entry);
+    }
+    else
+    {
+      e = &(*e)->next;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::remove(AsyncWebHandler* handler)
+{
+  Entry** e = &_linear;
+
+  while (*e != NULL)
+  {
+    if ((*e)->handler == handler)
+    {
+      Entry* entry = *e;
+      *e = entry->next;
+      _freeEntry(entry);
+    }
+    else
+    {
+      e = &(*e)->next;
+    }
+  }
+
+  _removeEntries(&_root, handler);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::_freeNode(Node* node)
+{
+  while (node->child != NULL)
+  {
+    Node* child = node->child;
+    node->child = child->next;
+
+    _freeNode(child);
+    free(child->segment);
+    delete child;
+  }
+
+  while (node->entries != NULL)
+  {
+    Entry* entry = node->entries;
+    node->entries = entry->next;
+    _freeEntry(entry);
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRouteIndex::clear()
+{
+  _freeNode(&_root);
+
+  while (_linear != NULL)
+  {
+    Entry* entry = _linear;
+    _linear = entry->next;
+    _freeEntry(entry);
+  }
+
+  _seq = 0;
+}
+
+/////////////////////////////////////////////////
+
+// Walk every branch the url matches, "{name}" nodes and literal ones, keeping the first added matching entry
+void AsyncWebRouteIndex::_find(const Node* node, const char* p, AsyncWebServerRequest* request, uint32_t segmentHash,
+                               const Entry** best) const
+{
+  // p is the rest of the url below node, NULL once the url ends at node
+  for (const Entry* e = node->entries; e != NULL; e = e->next)
+  {
+    if (*best != NULL && e->seq > (*best)->seq)
+      break;
+
+    if (e->exact && p != NULL)
+      continue;
+
+    if (e->partial != NULL && (p == NULL || strncmp(p, e->partial, e->partialLength)))
+      continue;
+
+    AsyncCallbackWebHandler* h = static_cast<AsyncCallbackWebHandler*>(e->handler);
+
+    // Same as AsyncCallbackWebHandler::canHandle(), the uri being matched by the trie
+    if (h->prefilter(request->method(), segmentHash) && !h->isRequestHandlerTrivial() && h->filter(request))
+    {
+      *best = e;
+      break;
+    }
+  }
+
+  if (p == NULL)
+    return;
+
+  const char* slash = strchr(p, '/');
+  const size_t len = slash ? (size_t) (slash - p) : strlen(p);
+
+  for (const Node* n = node->child; n != NULL; n = n->next)
+  {
+    if (n->param ? (len > 0) : (n->segmentLength == len && !memcmp(n->segment, p, len)))
+      _find(n, slash ? slash + 1 : NULL, request, segmentHash, best);
+  }
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebHandler* AsyncWebRouteIndex::find(AsyncWebServerRequest* request) const
+{
+  const Entry* best = NULL;
+  const char* p = request->url().c_str();
+  const WebRequestMethodComposite method = request->method();
+  const uint32_t hash = segmentHash(p);
+
+  if (*p == '/')
+    _find(&_root, p + 1, request, hash, &best);
+
+  for (const Entry* e = _linear; e != NULL; e = e->next)
+  {
+    if (best != NULL && e->seq > best->seq)
+      break;
+
+    // Integer compares before the std::function filter and the virtual canHandle()
+    if (!e->handler->prefilter(method, hash))
+      continue;
+
+    if (e->handler->filter(request) && e->handler->canHandle(request))
+      return e->handler;
+  }
+
+  // Let a template handler add its path params
+  if (best != NULL && best->exact)
+    best->handler->canHandle(request);
+
+  return best ? best->handler : NULL;
+}
+
+/////////////////////////////////////////////////
+
+uint32_t AsyncWebRouteIndex::segmentHash(const char* url)
+{
+  if (*url == '/')
+    url++;
+
+  uint32_t hash = 2166136261UL;
+
+  while (*url && *url != '/')
+  {
+    hash ^= (uint8_t) *url++;
+    hash *= 16777619UL;
+  }
+
+  return hash ? hash : 1;
+}
+
+/////////////////////////////////////////////////
+/////////////////////////////////////////////////
+
+AsyncWebRewriteIndex::AsyncWebRewriteIndex()
+  : _linear(NULL), _seq(0)
+{
+  memset(_buckets, 0, sizeof(_buckets));
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRewriteIndex::~AsyncWebRewriteIndex()
+{
+  clear();
+}
+
+/////////////////////////////////////////////////
+
+// FNV-1a
+uint32_t AsyncWebRewriteIndex::_hash(const char* text, size_t len)
+{
+  uint32_t hash = 2166136261UL;
+
+  while (len--)
+  {
+    hash ^= (uint8_t) *text++;
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRewriteIndex::_append(Entry** list, Entry* entry)
+{
+  while (*list != NULL)
+    list = &(*list)->next;
+
+  *list = entry;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRewriteIndex::_remove(Entry** list, AsyncWebRewrite* rewrite)
+{
+  while (*list != NULL)
+  {
+    if ((*list)->rewrite == rewrite)
+    {
+      Entry* entry = *list;
+      *list = entry->next;
+      delete entry;
+    }
+    else
+    {
+      list = &(*list)->next;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRewriteIndex::_free(Entry** list)
+{
+  while (*list != NULL)
+  {
+    Entry* entry = *list;
+    *list = entry->next;
+    delete entry;
+  }
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRewriteIndex::Entry* AsyncWebRewriteIndex::_newEntry(AsyncWebRewrite* rewrite, uint32_t hash)
+{
+  Entry* entry = new Entry();
+
+  if (entry == NULL)
+    return NULL;
+
+  entry->rewrite = rewrite;
+  entry->seq = _seq++;
+  entry->hash = hash;
+  entry->next = NULL;
+
+  return entry;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRewriteIndex::add(AsyncWebRewrite* rewrite)
+{
+  Entry* entry = _newEntry(rewrite, 0);
+
+  if (entry != NULL)
+    _append(&_linear, entry);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRewriteIndex::addExact(AsyncWebRewrite* rewrite)
+{
+  const uint32_t hash = _hash(rewrite->from().c_str(), rewrite->from().length());
+  Entry* entry = _newEntry(rewrite, hash);
+
+  if (entry != NULL)
+    _append(&_buckets[hash % ASYNCWEBSERVER_REWRITE_HASH_SIZE], entry);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRewriteIndex::remove(AsyncWebRewrite* rewrite)
+{
+  _remove(&_linear, rewrite);
+
+  for (size_t i = 0; i < ASYNCWEBSERVER_REWRITE_HASH_SIZE; i++)
+    _remove(&_buckets[i], rewrite);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebRewriteIndex::clear()
+{
+  _free(&_linear);
+
+  for (size_t i = 0; i < ASYNCWEBSERVER_REWRITE_HASH_SIZE; i++)
+    _free(&_buckets[i]);
+
+  _seq = 0;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebRewrite* AsyncWebRewriteIndex::find(AsyncWebServerRequest* request, uint32_t& seq) const
+{
+  const String& url = request->url();
+  const uint32_t hash = _hash(url.c_str(), url.length());
+  const Entry* best = NULL;
+
+  for (const Entry* e = _buckets[hash % ASYNCWEBSERVER_REWRITE_HASH_SIZE]; e != NULL; e = e->next)
+  {
+    if (e->seq >= seq && e->hash == hash && e->rewrite->from() == url && e->rewrite->filter(request))
+    {
+      best = e;
+      break;
+    }
+  }
+
+  for (const Entry* e = _linear; e != NULL; e = e->next)
+  {
+    if (best != NULL && e->seq > best->seq)
+      break;
+
+    if (e->seq >= seq && e->rewrite->match(request))
+    {
+      best = e;
+      break;
+    }
+  }
+
+  if (best == NULL)
+    return NULL;
+
+  seq = best->seq + 1;
+
+  return best->rewrite;
+}
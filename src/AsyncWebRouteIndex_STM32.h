@@ -0,0 +1,187 @@
+/****************************************************************************************************************************
+  AsyncWebRouteIndex_STM32.h - Dead simple AsyncWebServer for STM32 LAN8720 or built-in LAN8742A Ethernet
+
+  For STM32 with LAN8720 (STM32F4/F7) or built-in LAN8742A Ethernet (Nucleo-144, DISCOVERY, etc)
+
+  AsyncWebServer_STM32 is a library for the STM32 with LAN8720 or built-in LAN8742A Ethernet WebServer
+
+  Based on and modified from ESPAsyncWebServer (https://github.com/me-no-dev/ESPAsyncWebServer)
+  Built by Khoi Hoang https://github.com/khoih-prog/AsyncWebServer_STM32
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+  This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License
+  as published bythe Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+  This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License along with this program.
+  If not, see <https://www.gnu.org/licenses/>
+
+  Version: 1.7.0
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.2.3   K Hoang      02/09/2020 Initial coding for STM32 for built-in Ethernet (Nucleo-144, DISCOVERY, etc).
+                                  Bump up version to v1.2.3 to sync with ESPAsyncWebServer v1.2.3
+  1.2.4   K Hoang      05/09/2020 Add back MD5/SHA1 authentication feature.
+  1.2.5   K Hoang      28/12/2020 Suppress all possible compiler warnings. Add examples.
+  1.2.6   K Hoang      22/03/2021 Fix dependency on STM32AsyncTCP Library
+  1.3.0   K Hoang      14/04/2021 Add support to LAN8720 using STM32F4 or STM32F7
+  1.3.1   K Hoang      09/10/2021 Update `platform.ini` and `library.json`
+  1.4.0   K Hoang      14/12/2021 Fix base64 encoding of websocket client key and add WebServer progmem support
+  1.4.1   K Hoang      12/01/2022 Fix authenticate issue caused by libb64
+  1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
+  1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
+  1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
+ *****************************************************************************************************************************/
+
+#pragma once
+
+#ifndef ASYNCWEBROUTEINDEX_STM32_H_
+#define ASYNCWEBROUTEINDEX_STM32_H_
+
+#include "Arduino.h"
+
+class AsyncWebHandler;
+class AsyncCallbackWebHandler;
+class AsyncWebRewrite;
+class AsyncWebServerRequest;
+
+// Buckets of the rewrite hash table
+#ifndef ASYNCWEBSERVER_REWRITE_HASH_SIZE
+  #define ASYNCWEBSERVER_REWRITE_HASH_SIZE          16
+#endif
+
+/////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////
+
+/*
+   ROUTE INDEX :: Finds the handler of a request without asking every handler in turn
+
+   Handlers added with AsyncWebServer::on() are kept in a trie keyed on the segments of their uri.
+   Other handlers (static files, WebSocket, EventSource, custom) are asked in order as before.
+   The first matching handler in the order they were added wins, wherever it is kept
+ * */
+
+class AsyncWebRouteIndex
+{
+  private:
+    struct Entry
+    {
+      AsyncWebHandler* handler;
+      uint32_t seq;
+
+      // Rest of a wildcard uri after its last '/', NULL if the uri matches itself and everything below it
+      char* partial;
+      size_t partialLength;
+
+      // Template uri, only matching urls ending at its node
+      bool exact;
+
+      Entry* next;
+    };
+
+    struct Node
+    {
+      char* segment;
+      size_t segmentLength;
+
+      // "{name}" segment of template uris, matching any non empty url segment
+      bool param;
+
+      Node* child;
+      Node* next;
+      Entry* entries;
+    };
+
+    Node _root;
+
+    // Handlers not kept in the trie, in the order they were added
+    Entry* _linear;
+
+    uint32_t _seq;
+
+    Node* _addNode(Node* parent, const char* segment, size_t len, bool param);
+    void _removeEntries(Node* node, AsyncWebHandler* handler);
+    void _freeNode(Node* node);
+    void _find(const Node* node, const char* p, AsyncWebServerRequest* request, uint32_t segmentHash,
+               const Entry** best) const;
+
+    static void _append(Entry** list, Entry* entry);
+    static void _freeEntry(Entry* entry);
+
+  public:
+    AsyncWebRouteIndex();
+    ~AsyncWebRouteIndex();
+
+    // Handler checked with filter() and canHandle() in order
+    void add(AsyncWebHandler* handler);
+
+    // Handler matched through the trie if its uri allows it, else checked in order
+    void add(AsyncCallbackWebHandler* handler, const char* uri);
+
+    void remove(AsyncWebHandler* handler);
+    void clear();
+
+    AsyncWebHandler* find(AsyncWebServerRequest* request) const;
+
+    // FNV-1a of the first segment of a url, "api" of "/api/v1", compared to the path prefix of the handlers. Never 0
+    static uint32_t segmentHash(const char* url);
+};
+
+/////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////
+
+/*
+   REWRITE INDEX :: Finds the rewrites of a request without asking every rewrite in turn
+
+   Rewrites added with AsyncWebServer::rewrite() match their from() url exactly and are kept in a hash table.
+   Other rewrites, possibly overriding match(), are asked in order as before.
+   Rewrites still apply in the order they were added, each one to the url left by the previous ones
+ * */
+
+class AsyncWebRewriteIndex
+{
+  private:
+    struct Entry
+    {
+      AsyncWebRewrite* rewrite;
+      uint32_t seq;
+      uint32_t hash;
+
+      Entry* next;
+    };
+
+    Entry* _buckets[ASYNCWEBSERVER_REWRITE_HASH_SIZE];
+
+    // Rewrites not kept in the hash table, in the order they were added
+    Entry* _linear;
+
+    uint32_t _seq;
+
+    Entry* _newEntry(AsyncWebRewrite* rewrite, uint32_t hash);
+
+    static uint32_t _hash(const char* text, size_t len);
+    static void _append(Entry** list, Entry* entry);
+    static void _remove(Entry** list, AsyncWebRewrite* rewrite);
+    static void _free(Entry** list);
+
+  public:
+    AsyncWebRewriteIndex();
+    ~AsyncWebRewriteIndex();
+
+    // Rewrite checked with match() in order
+    void add(AsyncWebRewrite* rewrite);
+
+    // Rewrite matching from() exactly, looked up by hash
+    void addExact(AsyncWebRewrite* rewrite);
+
+    void remove(AsyncWebRewrite* rewrite);
+    void clear();
+
+    // First rewrite matching the request from the seq one on, seq being moved past it
+    AsyncWebRewrite* find(AsyncWebServerRequest* request, uint32_t& seq) const;
+};
+
+#endif /* ASYNCWEBROUTEINDEX_STM32_H_ */
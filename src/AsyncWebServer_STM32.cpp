@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #if !defined(_ASYNCWEBSERVER_STM32_LOGLEVEL_)
@@ -46,6 +47,292 @@
 
 /////////////////////////////////////////////////
 
+AsyncWebSendBuffer::AsyncWebSendBuffer()
+  : _lent(false)
+{
+}
+
+/////////////////////////////////////////////////
+
+uint8_t* AsyncWebSendBuffer::borrow()
+{
+  if (_lent)
+    return NULL;
+
+  _lent = true;
+
+  return _buffer;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebSendBuffer::giveBack(uint8_t* buffer)
+{
+  if (buffer == _buffer)
+    _lent = false;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebResponseCache::AsyncWebResponseCache()
+  : _arena(NULL), _uses(0)
+{
+  memset(_entries, 0, sizeof(_entries));
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebResponseCache::~AsyncWebResponseCache()
+{
+  free(_arena);
+}
+
+/////////////////////////////////////////////////
+
+// GET requests whose response depends on the url only, as far as the server can tell. Credentials are checked with
+// _authorization, parsed even when no handler keeps the header. Conditional and Range requests go to their handler,
+// the cache only having the full 200 response. The query is parsed last, only for otherwise cacheable requests
+bool AsyncWebResponseCache::_cacheable(AsyncWebServerRequest *request)
+{
+  return request->method() == HTTP_GET && request->version() && !request->contentLength()
+         && !request->_authorization.length() && !request->hasHeader(HEADER_AUTHORIZATION)
+         && !request->hasHeader(HEADER_IF_NONE_MATCH) && !request->hasHeader(HEADER_IF_MODIFIED_SINCE)
+         && !request->hasHeader(HEADER_RANGE) && !request->params();
+}
+
+/////////////////////////////////////////////////
+
+int AsyncWebResponseCache::_find(const String& url, bool fresh)
+{
+  const uint32_t now = millis();
+
+  for (int i = 0; i < ASYNCWEBSERVER_RESPONSE_CACHE_ENTRIES; i++)
+  {
+    Entry& entry = _entries[i];
+
+    if (!entry.used || entry.stale || entry.urlLength != url.length()
+        || memcmp(_arena + entry.offset, url.c_str(), entry.urlLength) != 0)
+      continue;
+
+    if (fresh && (int32_t)(entry.expires - now) <= 0)
+      return -1;
+
+    entry.lastUse = ++_uses;
+
+    return i;
+  }
+
+  return -1;
+}
+
+/////////////////////////////////////////////////
+
+// Drop entries, expired ones first then the least recently used, until an entry and len bytes are free, and pack
+// the arena. Returns the free entry, placed after the others, -1 if the entries being sent take too much room
+int AsyncWebResponseCache::_makeRoom(size_t len)
+{
+  const uint32_t now = millis();
+
+  while (true)
+  {
+    size_t used = 0;
+    int vacant = -1;
+    int victim = -1;
+    bool victimExpired = false;
+
+    for (int i = 0; i < ASYNCWEBSERVER_RESPONSE_CACHE_ENTRIES; i++)
+    {
+      const Entry& entry = _entries[i];
+
+      if (!entry.used)
+      {
+        if (vacant < 0)
+          vacant = i;
+
+        continue;
+      }
+
+      used += _size(entry);
+
+      if (entry.pins)
+        continue;
+
+      const bool expired = (int32_t)(entry.expires - now) <= 0;
+
+      if (victim < 0 || (expired && !victimExpired)
+          || (expired == victimExpired && entry.lastUse < _entries[victim].lastUse))
+      {
+        victim = i;
+        victimExpired = expired;
+      }
+    }
+
+    if (vacant >= 0 && used + len <= ASYNCWEBSERVER_RESPONSE_CACHE_SIZE)
+    {
+      _compact();
+      _entries[vacant].offset = used;
+
+      return vacant;
+    }
+
+    if (victim < 0)
+      return -1;
+
+    _entries[victim].used = false;
+  }
+}
+
+/////////////////////////////////////////////////
+
+// Move the entries down, in their order, over the room of the dropped ones
+void AsyncWebResponseCache::_compact()
+{
+  size_t end = 0;
+
+  while (true)
+  {
+    int next = -1;
+
+    for (int i = 0; i < ASYNCWEBSERVER_RESPONSE_CACHE_ENTRIES; i++)
+    {
+      if (_entries[i].used && _entries[i].offset >= end && (next < 0 || _entries[i].offset < _entries[next].offset))
+        next = i;
+    }
+
+    if (next < 0)
+      return;
+
+    Entry& entry = _entries[next];
+
+    if (entry.offset != end)
+    {
+      memmove(_arena + end, _arena + entry.offset, _size(entry));
+      entry.offset = end;
+    }
+
+    end += _size(entry);
+  }
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebResponseCache::_release(int entry)
+{
+  if (--_entries[entry].pins == 0 && _entries[entry].stale)
+    _entries[entry].used = false;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebServerResponse* AsyncWebResponseCache::store(AsyncWebServerRequest *request, AsyncWebServerResponse *response)
+{
+  if (!_cacheable(request) || response->_code != 200 || !response->_sendContentLength || response->_chunked)
+    return NULL;
+
+  // Cached responses are served without running the handler again, so neither its filter() nor its credentials
+  if (request->_handler == NULL || request->_handler->isRestricted())
+    return NULL;
+
+  const String& url = request->url();
+
+  // Sized as sent from the cache, with "Accept-Ranges: none", the response being left as is until stored
+  const bool acceptRanges = response->_acceptRanges;
+  response->_acceptRanges = false;
+  const size_t headLength = response->_headSize(request->version());
+  response->_acceptRanges = acceptRanges;
+  const size_t bodyLength = response->_contentLength;
+  const size_t len = url.length() + 1 + headLength + bodyLength;
+
+  if (len > ASYNCWEBSERVER_RESPONSE_CACHE_SIZE)
+    return NULL;
+
+  if (_arena == NULL && (_arena = (uint8_t*) malloc(ASYNCWEBSERVER_RESPONSE_CACHE_SIZE)) == NULL)
+    return NULL;
+
+  // Replaces the expired response of the url, kept until no more sent
+  const int previous = _find(url, false);
+
+  if (previous >= 0)
+  {
+    if (_entries[previous].pins)
+      _entries[previous].stale = true;
+    else
+      _entries[previous].used = false;
+  }
+
+  const int i = _makeRoom(len);
+
+  if (i < 0)
+    return NULL;
+
+  Entry& entry = _entries[i];
+  uint8_t* data = _arena + entry.offset;
+
+  // The body first, the response still being sent as is if it can't be rendered
+  if (!response->_renderContent(data + url.length() + 1 + headLength, bodyLength))
+    return NULL;
+
+  // Range requests of the url are answered from the cache with the full content
+  response->_acceptRanges = false;
+
+  const String head = response->_assembleHead(request->version());
+
+  if (head.length() != headLength)
+    return NULL;
+
+  memcpy(data, url.c_str(), url.length() + 1);
+  memcpy(data + url.length() + 1, head.c_str(), headLength);
+
+  entry.urlLength = url.length();
+  entry.headLength = headLength;
+  entry.bodyLength = bodyLength;
+  entry.expires = millis() + response->_cacheTTL;
+  entry.lastUse = ++_uses;
+  entry.pins = 0;
+  entry.stale = false;
+  entry.used = true;
+
+  LOGDEBUG3("AsyncWebResponseCache::store : url =", url, ", len =", len);
+
+  return new AsyncCachedResponse(this, i);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebResponseCache::clear()
+{
+  for (int i = 0; i < ASYNCWEBSERVER_RESPONSE_CACHE_ENTRIES; i++)
+  {
+    if (_entries[i].pins)
+      _entries[i].stale = true;
+    else
+      _entries[i].used = false;
+  }
+}
+
+/////////////////////////////////////////////////
+
+bool AsyncWebResponseCache::canHandle(AsyncWebServerRequest *request)
+{
+  // Urls not cached are rejected before _cacheable() parses the query
+  return _arena != NULL && _find(request->url(), true) >= 0 && _cacheable(request);
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebResponseCache::handleRequest(AsyncWebServerRequest *request)
+{
+  // Found by canHandle() just before, nothing being stored in between
+  const int entry = _find(request->url(), false);
+
+  if (entry < 0)
+    request->send(500);
+  else
+    request->send(new AsyncCachedResponse(this, entry));
+}
+
+/////////////////////////////////////////////////
+
 AsyncWebServer::AsyncWebServer(uint16_t port)
   : _server(port), _rewrites(LinkedList<AsyncWebRewrite * >([](AsyncWebRewrite * r)
 {
@@ -55,6 +342,8 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
 {
   delete h;
 }))
+, _keepAlive(false), _keepAliveMaxRequests(ASYNCWEBSERVER_KEEPALIVE_MAX_REQUESTS)
+, _keepAliveTimeout(ASYNCWEBSERVER_KEEPALIVE_TIMEOUT), _headerMask(HEADER_MASK_REQUEST)
 {
   _catchAllHandler = new AsyncCallbackWebHandler();
 
@@ -98,6 +387,7 @@ AsyncWebServer::~AsyncWebServer()
 AsyncWebRewrite& AsyncWebServer::addRewrite(AsyncWebRewrite* rewrite)
 {
   _rewrites.add(rewrite);
+  _rewriteIndex.add(rewrite);
 
   return *rewrite;
 }
@@ -106,6 +396,8 @@ AsyncWebRewrite& AsyncWebServer::addRewrite(AsyncWebRewrite* rewrite)
 
 bool AsyncWebServer::removeRewrite(AsyncWebRewrite *rewrite)
 {
+  _rewriteIndex.remove(rewrite);
+
   return _rewrites.remove(rewrite);
 }
 
@@ -113,7 +405,12 @@ bool AsyncWebServer::removeRewrite(AsyncWebRewrite *rewrite)
 
 AsyncWebRewrite& AsyncWebServer::rewrite(const char* from, const char* to)
 {
-  return addRewrite(new AsyncWebRewrite(from, to));
+  AsyncWebRewrite* rewrite = new AsyncWebRewrite(from, to);
+
+  _rewrites.add(rewrite);
+  _rewriteIndex.addExact(rewrite);
+
+  return *rewrite;
 }
 
 /////////////////////////////////////////////////
@@ -121,6 +418,37 @@ AsyncWebRewrite& AsyncWebServer::rewrite(const char* from, const char* to)
 AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler)
 {
   _handlers.add(handler);
+  _routes.add(handler);
+  _updateHeaderMask();
+
+  return *handler;
+}
+
+/////////////////////////////////////////////////
+
+AsyncRomWebHandler& AsyncWebServer::serveStatic(const char* uri, const AsyncWebRomFS& fs, const char* cache_control)
+{
+  AsyncRomWebHandler* handler = new AsyncRomWebHandler(uri, fs, cache_control ? cache_control : "");
+  addHandler(handler);
+
+  return *handler;
+}
+
+/////////////////////////////////////////////////
+
+AsyncWebHandler& AsyncWebServer::addRoutes(const AsyncWebRoute* routes, size_t count)
+{
+  return addHandler(new AsyncRouteTableWebHandler(routes, count));
+}
+
+/////////////////////////////////////////////////
+
+AsyncCallbackWebHandler& AsyncWebServer::_addRoute(AsyncCallbackWebHandler* handler, const char* uri)
+{
+  _handlers.add(handler);
+  _routes.add(handler, uri);
+  _updateHeaderMask();
+
   return *handler;
 }
 
@@ -128,13 +456,33 @@ AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler)
 
 bool AsyncWebServer::removeHandler(AsyncWebHandler *handler)
 {
-  return _handlers.remove(handler);
+  _routes.remove(handler);
+
+  bool removed = _handlers.remove(handler);
+
+  _updateHeaderMask();
+
+  return removed;
+}
+
+/////////////////////////////////////////////////
+
+void AsyncWebServer::_updateHeaderMask()
+{
+  _headerMask = (_catchAllHandler ? _catchAllHandler->interestingHeaders() : HEADER_MASK_NONE);
+
+  for (const auto& h : _handlers)
+  {
+    _headerMask |= h->interestingHeaders();
+  }
 }
 
 /////////////////////////////////////////////////
 
 void AsyncWebServer::begin()
 {
+  _updateHeaderMask();
+
   _server.setNoDelay(true);
   _server.begin();
 }
@@ -148,6 +496,15 @@ void AsyncWebServer::end()
 
 /////////////////////////////////////////////////
 
+void AsyncWebServer::setKeepAlive(bool enable, uint16_t maxRequests, uint16_t timeout)
+{
+  _keepAlive = enable;
+  _keepAliveMaxRequests = maxRequests;
+  _keepAliveTimeout = timeout;
+}
+
+/////////////////////////////////////////////////
+
 #if ASYNC_TCP_SSL_ENABLED
 void AsyncWebServer::onSslFileRequest(AcSSlFileHandler cb, void* arg)
 {
@@ -173,13 +530,15 @@ void AsyncWebServer::_handleDisconnect(AsyncWebServerRequest *request)
 
 void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request)
 {
-  for (const auto& r : _rewrites)
+  uint32_t seq = 0;
+  AsyncWebRewrite* r;
+
+  while ((r = _rewriteIndex.find(request, seq)) != NULL)
   {
-    if (r->match(request))
-    {
-      request->_url = r->toUrl();
-      request->_addGetParams(r->params());
-    }
+    request->_url = r->toUrl();
+
+    for (const auto& p : r->paramList())
+      request->_addParam(new AsyncWebParameter(*p));
   }
 }
 
@@ -187,17 +546,16 @@ void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request)
 
 void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request)
 {
-  for (const auto& h : _handlers)
+  if (_responseCache.canHandle(request))
   {
-    if (h->filter(request) && h->canHandle(request))
-    {
-      request->setHandler(h);
-      return;
-    }
+    request->setHandler(&_responseCache);
+
+    return;
   }
 
-  request->addInterestingHeader("ANY");
-  request->setHandler(_catchAllHandler);
+  AsyncWebHandler* handler = _routes.find(request);
+
+  request->setHandler(handler ? handler : _catchAllHandler);
 }
 
 /////////////////////////////////////////////////
@@ -213,9 +571,8 @@ AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodCom
   handler->onRequest(onRequest);
   handler->onUpload(onUpload);
   handler->onBody(onBody);
-  addHandler(handler);
 
-  return *handler;
+  return _addRoute(handler, uri);
 }
 
 /////////////////////////////////////////////////
@@ -229,9 +586,8 @@ AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodCom
   handler->setMethod(method);
   handler->onRequest(onRequest);
   handler->onUpload(onUpload);
-  addHandler(handler);
 
-  return *handler;
+  return _addRoute(handler, uri);
 }
 
 /////////////////////////////////////////////////
@@ -243,9 +599,8 @@ AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodCom
   handler->setUri(uri);
   handler->setMethod(method);
   handler->onRequest(onRequest);
-  addHandler(handler);
 
-  return *handler;
+  return _addRoute(handler, uri);
 }
 
 /////////////////////////////////////////////////
@@ -255,16 +610,17 @@ AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, ArRequestHandlerFun
   AsyncCallbackWebHandler* handler = new AsyncCallbackWebHandler();
   handler->setUri(uri);
   handler->onRequest(onRequest);
-  addHandler(handler);
 
-  return *handler;
+  return _addRoute(handler, uri);
 }
 
 /////////////////////////////////////////////////
 
-void AsyncWebServer::onNotFound(ArRequestHandlerFunction fn)
+AsyncCallbackWebHandler& AsyncWebServer::onNotFound(ArRequestHandlerFunction fn)
 {
   _catchAllHandler->onRequest(fn);
+
+  return *_catchAllHandler;
 }
 
 /////////////////////////////////////////////////
@@ -278,7 +634,10 @@ void AsyncWebServer::onRequestBody(ArBodyHandlerFunction fn)
 
 void AsyncWebServer::reset()
 {
+  _responseCache.clear();
+  _rewriteIndex.clear();
   _rewrites.free();
+  _routes.clear();
   _handlers.free();
 
   if (_catchAllHandler != NULL)
@@ -286,7 +645,10 @@ void AsyncWebServer::reset()
     _catchAllHandler->onRequest(NULL);
     _catchAllHandler->onUpload(NULL);
     _catchAllHandler->onBody(NULL);
+    _catchAllHandler->setInterestingHeaders(HEADER_MASK_REQUEST);
   }
+
+  _updateHeaderMask();
 }
 
 /////////////////////////////////////////////////
@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #ifndef _AsyncWebServer_STM32_H_
@@ -40,13 +41,13 @@
 
 /////////////////////////////////////////////////
 
-#define ASYNC_WEBSERVER_STM32_VERSION           "AsyncWebServer_STM32 v1.6.1"
+#define ASYNC_WEBSERVER_STM32_VERSION           "AsyncWebServer_STM32 v1.7.0"
 
 #define ASYNC_WEBSERVER_STM32_VERSION_MAJOR     1
-#define ASYNC_WEBSERVER_STM32_VERSION_MINOR     6
-#define ASYNC_WEBSERVER_STM32_VERSION_PATCH     1
+#define ASYNC_WEBSERVER_STM32_VERSION_MINOR     7
+#define ASYNC_WEBSERVER_STM32_VERSION_PATCH     0
 
-#define ASYNC_WEBSERVER_STM32_VERSION_INT       1006001
+#define ASYNC_WEBSERVER_STM32_VERSION_INT       1007000
 
 /////////////////////////////////////////////////
 
@@ -63,6 +64,7 @@
 
 #include "AsyncWebServer_Debug_STM32.h"
 #include "StringArray_STM32.h"
+#include "AsyncWebRouteIndex_STM32.h"
 
 /////////////////////////////////////////////////
 
@@ -70,12 +72,68 @@
   #if(_ASYNCWEBSERVER_STM32_LOGLEVEL_>3)
     #warning Using ASYNCWEBSERVER_REGEX
   #endif
+#endif
+
+/////////////////////////////////////////////////
+
+// HTTP/1.1 persistent connections, enabled with AsyncWebServer::setKeepAlive()
+#ifndef ASYNCWEBSERVER_KEEPALIVE_MAX_REQUESTS
+  #define ASYNCWEBSERVER_KEEPALIVE_MAX_REQUESTS     100
+#endif
+
+// Idle time in seconds before a kept-alive connection is closed
+#ifndef ASYNCWEBSERVER_KEEPALIVE_TIMEOUT
+  #define ASYNCWEBSERVER_KEEPALIVE_TIMEOUT          5
+#endif
 
-  #define ASYNCWEBSERVER_REGEX_ATTRIBUTE
-#else
-  #define ASYNCWEBSERVER_REGEX_ATTRIBUTE __attribute__((warning("ASYNCWEBSERVER_REGEX not defined")))
+// Per-connection arena holding the request line and headers, larger heads are answered with 431
+#ifndef ASYNCWEBSERVER_REQUEST_HEAD_SIZE
+  #define ASYNCWEBSERVER_REQUEST_HEAD_SIZE          1460
 #endif
 
+#ifndef ASYNCWEBSERVER_REQUEST_MAX_HEADERS
+  #define ASYNCWEBSERVER_REQUEST_MAX_HEADERS        32
+#endif
+
+// Path params ("{name}" uri segments or regex groups) kept per request, the following ones are ignored
+#ifndef ASYNCWEBSERVER_REQUEST_MAX_PATH_PARAMS
+  #define ASYNCWEBSERVER_REQUEST_MAX_PATH_PARAMS    8
+#endif
+
+// Bytes of pipelined requests buffered while the current response is sent, the connection is closed on overflow
+#ifndef ASYNCWEBSERVER_PIPELINE_BUFFER_SIZE
+  #define ASYNCWEBSERVER_PIPELINE_BUFFER_SIZE       1460
+#endif
+
+// Bytes of request body held back while a handleBodyStream() handler can't keep up, the connection is closed on overflow.
+// Should cover the TCP receive window (TCP_WND) as the peer may send that much before the window closes
+#ifndef ASYNCWEBSERVER_BODY_STASH_SIZE
+  #define ASYNCWEBSERVER_BODY_STASH_SIZE            (4 * 1460)
+#endif
+
+// Send buffer owned by the server, which responses borrow while they fill and queue their content
+#ifndef ASYNCWEBSERVER_SEND_BUFFER_SIZE
+  #define ASYNCWEBSERVER_SEND_BUFFER_SIZE           1460
+#endif
+
+// PROGMEM contents whose webETag_P() is remembered instead of hashed again
+#ifndef ASYNCWEBSERVER_ETAG_CACHE_SIZE
+  #define ASYNCWEBSERVER_ETAG_CACHE_SIZE            8
+#endif
+
+// Bytes of the response cache of responses marked with setCacheable(), allocated when the first one is stored.
+// 0 disables the cache
+#ifndef ASYNCWEBSERVER_RESPONSE_CACHE_SIZE
+  #define ASYNCWEBSERVER_RESPONSE_CACHE_SIZE        4096
+#endif
+
+// Responses kept at most in the response cache, the least recently used one being dropped for a new one
+#ifndef ASYNCWEBSERVER_RESPONSE_CACHE_ENTRIES
+  #define ASYNCWEBSERVER_RESPONSE_CACHE_ENTRIES     8
+#endif
+
+/////////////////////////////////////////////////
+
 #define DEBUGF(...) Serial.printf(__VA_ARGS__)
 
 static const String SharedEmptyString = String();
@@ -90,14 +148,18 @@ class AsyncWebParameter;
 class AsyncWebRewrite;
 class AsyncWebHandler;
 class AsyncStaticWebHandler;
+class AsyncRomWebHandler;
 class AsyncCallbackWebHandler;
+class AsyncRouteTableWebHandler;
 class AsyncResponseStream;
+struct AsyncWebRoute;
 
 /////////////////////////////////////////////////
 
 #ifndef WEBSERVER_H
 typedef enum
 {
+  HTTP_UNKNOWN = 0b00000000,
   HTTP_GET     = 0b00000001,
   HTTP_POST    = 0b00000010,
   HTTP_DELETE  = 0b00000100,
@@ -243,16 +305,82 @@ class AsyncWebHeader
 
 typedef enum { RCT_NOT_USED = -1, RCT_DEFAULT = 0, RCT_HTTP, RCT_WS, RCT_EVENT, RCT_MAX } RequestedConnectionType;
 
+// Well-known request headers, interned while parsing so they're found by index instead of by name
+typedef enum
+{
+  HEADER_HOST = 0,
+  HEADER_CONNECTION,
+  HEADER_CONTENT_TYPE,
+  HEADER_CONTENT_LENGTH,
+  HEADER_EXPECT,
+  HEADER_AUTHORIZATION,
+  HEADER_UPGRADE,
+  HEADER_ORIGIN,
+  HEADER_SEC_WEBSOCKET_KEY,
+  HEADER_SEC_WEBSOCKET_VERSION,
+  HEADER_SEC_WEBSOCKET_PROTOCOL,
+  HEADER_SEC_WEBSOCKET_EXTENSIONS,
+  HEADER_ACCEPT,
+  HEADER_ACCEPT_ENCODING,
+  HEADER_ACCEPT_LANGUAGE,
+  HEADER_CACHE_CONTROL,
+  HEADER_COOKIE,
+  HEADER_IF_NONE_MATCH,
+  HEADER_IF_MODIFIED_SINCE,
+  HEADER_IF_RANGE,
+  HEADER_RANGE,
+  HEADER_LAST_EVENT_ID,
+  HEADER_REFERER,
+  HEADER_USER_AGENT,
+  HEADER_MAX,               // number of well-known headers, also used for any other header
+} WebHeaderId;
+
+const char * webHeaderName(WebHeaderId id);
+WebHeaderId webHeaderId(const char* name, size_t len);
+
+// Set of WebHeaderId. The bit of HEADER_MAX, HEADER_MASK_OTHER, stands for all the headers which aren't well-known
+typedef uint32_t WebHeaderMask;
+
+static_assert(HEADER_MAX < 32, "WebHeaderMask can't hold all WebHeaderId");
+
+#define HEADER_MASK_NONE      ((WebHeaderMask) 0)
+#define HEADER_MASK_OTHER     ((WebHeaderMask) 1 << HEADER_MAX)
+#define HEADER_MASK_ANY       ((WebHeaderMask) 0xFFFFFFFF)
+
+constexpr WebHeaderMask webHeaderMask()
+{
+  return HEADER_MASK_NONE;
+}
+
+// webHeaderMask(HEADER_HOST, HEADER_COOKIE) is evaluated at compile time
+template<typename... Ids>
+constexpr WebHeaderMask webHeaderMask(WebHeaderId id, Ids... ids)
+{
+  return ((WebHeaderMask) 1 << id) | webHeaderMask(ids...);
+}
+
+// Default of the handlers: the headers the request itself reads, for hasHeader() to agree with host(), contentType(),
+// authenticate(), notModified() and the Range support of the responses. Headers read by name, or asked for with
+// addInterestingHeader(), need HEADER_MASK_OTHER or HEADER_MASK_ANY
+#define HEADER_MASK_REQUEST   webHeaderMask(HEADER_HOST, HEADER_CONNECTION, HEADER_CONTENT_TYPE, HEADER_CONTENT_LENGTH, \
+                                            HEADER_EXPECT, HEADER_AUTHORIZATION, HEADER_UPGRADE, HEADER_ACCEPT,          \
+                                            HEADER_IF_NONE_MATCH, HEADER_IF_MODIFIED_SINCE, HEADER_RANGE, HEADER_IF_RANGE)
+
 typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
 typedef std::function<String(const String&)> AwsTemplateProcessor;
 
 /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////
 
+class AsyncWebSendBuffer;
+
 class AsyncWebServerRequest
 {
     friend class AsyncWebServer;
     friend class AsyncCallbackWebHandler;
+    friend class AsyncWebRewrite;
+    friend class AsyncWebResponseCache;
+    friend class AsyncRouteTableWebHandler;
 
   private:
     AsyncClient* _client;
@@ -266,6 +394,27 @@ class AsyncWebServerRequest
     uint8_t   _parseState;
     uint8_t   _version;
 
+    // Request line and headers are kept in place, NUL-terminated, and only turned into Strings on access
+    struct AsyncWebHeaderSlice
+    {
+      uint16_t name;
+      uint16_t nameLength;
+      uint16_t value;
+      uint16_t valueLength;
+      uint8_t  id;
+      AsyncWebHeader* object;
+    };
+
+    char      _head[ASYNCWEBSERVER_REQUEST_HEAD_SIZE];
+    uint16_t  _headLength;
+    uint16_t  _lineStart;
+    uint16_t  _query;
+    mutable uint16_t _queryLength;
+
+    mutable AsyncWebHeaderSlice _headers[ASYNCWEBSERVER_REQUEST_MAX_HEADERS];
+    uint8_t   _headerCount;
+    uint8_t   _headerIndex[HEADER_MAX];   // slot + 1 of the first header with this id, 0 if not received
+
     WebRequestMethodComposite _method;
 
     String    _url;
@@ -282,15 +431,29 @@ class AsyncWebServerRequest
     bool      _isMultipart;
     bool      _isPlainPost;
     bool      _expectingContinue;
+    bool      _keepAlive;
+    uint16_t  _requestCount;
     size_t    _contentLength;
     size_t    _parsedLength;
 
-    LinkedList<AsyncWebHeader *> _headers;
-    LinkedList<AsyncWebParameter *> _params;
-    LinkedList<String *> _pathParams;
+    mutable LinkedList<AsyncWebParameter *> _params;
+
+    // Path params are slices of _url, their String only created by pathArg()
+    struct AsyncWebPathParamSlice
+    {
+      uint16_t offset;
+      uint16_t length;
+      String*  object;
+    };
+
+    mutable AsyncWebPathParamSlice _pathParams[ASYNCWEBSERVER_REQUEST_MAX_PATH_PARAMS];
+    uint8_t   _pathParamCount;
+
+    // Route found by the AsyncRouteTableWebHandler::canHandle() of this request
+    const AsyncWebRoute* _route;
 
     uint8_t   _multiParseState;
-    uint8_t   _boundaryPosition;
+    size_t    _boundaryPosition;
     size_t    _itemStartIndex;
     size_t    _itemSize;
     String    _itemName;
@@ -301,26 +464,59 @@ class AsyncWebServerRequest
     size_t    _itemBufferIndex;
     bool      _itemIsFile;
 
+    uint8_t*  _pipeline;
+    size_t    _pipelineLength;
+
+    uint8_t*  _bodyStash;
+    size_t    _bodyStashLength;
+    size_t    _rxSegment;
+    size_t    _rxHeld;
+
     void _onPoll();
     void _onAck(size_t len, uint32_t time);
     void _onError(int8_t error);
     void _onTimeout(uint32_t time);
     void _onDisconnect();
     void _onData(void *buf, size_t len);
+    void _onResponseEnd();
+    void _recycle();
+    bool _queuePipelined(const uint8_t* data, size_t len);
+    bool _stashBody(const uint8_t* data, size_t len);
+    void _releaseHeld(size_t len);
 
     void _addParam(AsyncWebParameter*);
     void _addPathParam(const char *param);
+    void _addPathParam(size_t offset, size_t len);
 
+    bool _appendHead(const char* data, size_t len);
     bool _parseReqHead();
     bool _parseReqHeader();
     void _parseLine();
-    void _parsePlainPostChar(uint8_t data);
-    void _parseMultipartPostByte(uint8_t data, bool last);
+    void _parsePlainPost(const char* data, size_t len, bool last);
+    void _addPlainPostParam(const char* field, size_t len);
+    void _parseMultipartPost(uint8_t* data, size_t len);
+    void _parseMultipartPostByte(uint8_t data);
+    size_t _parseMultipartData(uint8_t* data, size_t len);
+    void _parseMultipartHeader();
+    bool _startMultipartItem();
+    void _endMultipartItem();
+    void _itemWrite(const uint8_t* data, size_t len);
+    void _itemReplay(size_t len);
+    bool _zeroCopyItem() const;
     void _addGetParams(const String& params);
+    void _addGetParams(const char* params, size_t len) const;
+    void _parseGetParams() const;
+    void _freeHeaders();
+    void _freePathParams();
+
+    int _findHeader(const char* name) const;
+    void _indexHeaders();
+    AsyncWebHeader* _headerObject(size_t i) const;
+    static String _urlDecode(const char* text, size_t len);
+    static void _splitParams(const char* params, size_t len, LinkedList<AsyncWebParameter *>& list);
 
-    void _handleUploadStart();
-    void _handleUploadByte(uint8_t data, bool last);
-    void _handleUploadEnd();
+    void _handleUploadData(const uint8_t* data, size_t len);
+    void _flushUpload();
 
   public:
     void *_tempObject;
@@ -386,6 +582,25 @@ class AsyncWebServerRequest
 
     /////////////////////////////////////////////////
 
+    // true if the connection will be reused for the next request once the response is sent
+    inline bool keepAlive() const
+    {
+      return _keepAlive;
+    }
+
+    /////////////////////////////////////////////////
+
+    // true while body data not consumed by handleBodyStream() is held back
+    inline bool bodyPaused() const
+    {
+      return (_bodyStashLength > 0);
+    }
+
+    // Offer the held back body data to the handler again, also done on every poll of the connection
+    void resumeBody();
+
+    /////////////////////////////////////////////////
+
     const char * methodToString() const;
     const char * requestedConnTypeToString() const;
 
@@ -426,6 +641,10 @@ class AsyncWebServerRequest
     void send(int code, const String& contentType = String(), const String& content = String());
     void send(int code, const String& contentType, const char *content, bool copyingSend = true);    // RSMOD
 
+    // content queued without any copy, lwIP referencing it until acknowledged, retransmissions included.
+    // It must stay unchanged until the response has been fully acknowledged, e.g. a constant or static string
+    void sendNoCopy(int code, const String& contentType, const char *content);
+
     void send(Stream &stream, const String& contentType, size_t len, AwsTemplateProcessor callback = nullptr);
     void send(const String& contentType, size_t len, AwsResponseFiller callback,
               AwsTemplateProcessor templateCallback = nullptr);
@@ -434,8 +653,9 @@ class AsyncWebServerRequest
 
     AsyncWebServerResponse *beginResponse(int code, const String& contentType = String(), const String& content = String());
     AsyncWebServerResponse *beginResponse(int code, const String& contentType, const char * content = nullptr); // RSMOD
+    AsyncWebServerResponse *beginResponseNoCopy(int code, const String& contentType, const char * content);
 
-    // KH add
+    // KH add. content is read while the response is sent and copied by lwIP, it must stay valid until then
     AsyncWebServerResponse *beginResponse(int code, const String& contentType, const uint8_t * content, size_t len,
                                           AwsTemplateProcessor callback = nullptr);
     //////
@@ -444,6 +664,7 @@ class AsyncWebServerRequest
                                           AwsTemplateProcessor callback = nullptr);
     AsyncWebServerResponse *beginResponse(const String& contentType, size_t len, AwsResponseFiller callback,
                                           AwsTemplateProcessor templateCallback = nullptr);
+    // content in flash is queued without copy, referenced by lwIP until acknowledged
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, const uint8_t * content,
                                             size_t len, AwsTemplateProcessor callback = nullptr);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, PGM_P content,
@@ -459,6 +680,23 @@ class AsyncWebServerRequest
     AsyncWebHeader* getHeader(const String& name) const;
     AsyncWebHeader* getHeader(size_t num) const;
 
+    // Constant time lookup of the well-known headers
+    bool hasHeader(WebHeaderId id) const;
+    AsyncWebHeader* getHeader(WebHeaderId id) const;
+
+    // Value of a well-known header without creating a String, NULL if not received
+    const char* headerValue(WebHeaderId id) const;
+
+    // Send buffer of the server, borrowed by the responses
+    AsyncWebSendBuffer& sendBuffer();
+
+    // Conditional GET: true if the copy cached by the client is current, If-None-Match being compared to etag,
+    // else If-Modified-Since to lastModified. The handler needs HEADER_IF_NONE_MATCH and HEADER_IF_MODIFIED_SINCE
+    bool notModified(const char* etag, const char* lastModified = NULL) const;
+
+    // 304 without body, with the ETag and Last-Modified headers given
+    void sendNotModified(const char* etag, const char* lastModified = NULL);
+
     size_t params() const;                      // get arguments count
     bool hasParam(const String& name, bool post = false, bool file = false) const;
 
@@ -479,9 +717,21 @@ class AsyncWebServerRequest
     const String& argName(size_t i) const;       // get request argument name by number
     bool hasArg(const char* name) const;         // check if argument exists
 
-    const String& ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(size_t i) const;
+    const String& pathArg(size_t i) const;       // get path param of a "{name}" uri segment or regex group
+
+    // Path params without creating a String. pathArgView() returns NULL if there is no such param,
+    // the text isn't NUL terminated. pathArgInt() and pathArgFloat() return defaultValue if it isn't a number
+    const char* pathArgView(size_t i, size_t& len) const;
+    long pathArgInt(size_t i, long defaultValue = 0) const;
+    float pathArgFloat(size_t i, float defaultValue = 0) const;
+
+    inline size_t pathArgs() const
+    {
+      return _pathParamCount;
+    }
 
     const String& header(const char* name) const;// get request header value by name
+    const String& header(WebHeaderId id) const;  // get well-known request header value
     const String& header(size_t i) const;        // get request header value by number
     const String& headerName(size_t i) const;    // get request header name by number
     String urlDecode(const String& text) const;
@@ -515,11 +765,18 @@ class AsyncWebRewrite
     String _params;
     ArRequestFilterFunction _filter;
 
+    // _params decoded once, copied to each rewritten request
+    LinkedList<AsyncWebParameter *> _paramList;
+
   public:
 
     /////////////////////////////////////////////////
 
     AsyncWebRewrite(const char* from, const char* to): _from(from), _toUrl(to), _params(String()), _filter(NULL)
+      , _paramList(LinkedList<AsyncWebParameter *>([](AsyncWebParameter * p)
+    {
+      delete p;
+    }))
     {
       int index = _toUrl.indexOf('?');
 
@@ -527,12 +784,17 @@ class AsyncWebRewrite
       {
         _params = _toUrl.substring(index + 1);
         _toUrl = _toUrl.substring(0, index);
+
+        AsyncWebServerRequest::_splitParams(_params.c_str(), _params.length(), _paramList);
       }
     }
 
     /////////////////////////////////////////////////
 
-    virtual ~AsyncWebRewrite() {}
+    virtual ~AsyncWebRewrite()
+    {
+      _paramList.free();
+    }
 
     /////////////////////////////////////////////////
 
@@ -572,6 +834,13 @@ class AsyncWebRewrite
 
     /////////////////////////////////////////////////
 
+    inline const LinkedList<AsyncWebParameter *>& paramList() const
+    {
+      return _paramList;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual bool match(AsyncWebServerRequest *request)
     {
       return from() == request->url() && filter(request);
@@ -581,6 +850,44 @@ class AsyncWebRewrite
 /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////
 
+/*
+   ROM FILESYSTEM :: Files compiled into flash, generated from a directory by utils/romfs_gen.py
+ * */
+
+struct AsyncWebRomFile
+{
+  const char*    path;          // url path, without the ".gz" of gzipped files
+  const uint8_t* data;
+  uint32_t       length;
+  const char*    contentType;
+  const char*    etag;          // quoted, as sent in the ETag header
+  const char*    headers;       // Content-Type, Content-Encoding, Vary and ETag header lines, assembled by the generator
+  bool           gzip;
+};
+
+/////////////////////////////////////////////////
+
+struct AsyncWebRomFS
+{
+  const AsyncWebRomFile* files; // sorted by path, the plain variant of a file before the gzipped one
+  size_t                 count;
+
+  // First variant of the file with path of len chars, NULL if there is none
+  const AsyncWebRomFile* find(const char* path, size_t len) const;
+
+  // Gzipped variant of the file if gzip is accepted and there is one, else the plain one if any
+  const AsyncWebRomFile* find(const char* path, size_t len, bool gzip) const;
+};
+
+/////////////////////////////////////////////////
+
+// Quoted strong ETag of PROGMEM content, e.g. for beginResponse_P(), hashed once and remembered by address.
+// Valid until the next call
+const char* webETag_P(const uint8_t* content, size_t len);
+
+/////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////
+
 /*
    HANDLER :: One instance can be attached to any Request (done by the Server)
  * */
@@ -591,9 +898,14 @@ class AsyncWebHandler
     ArRequestFilterFunction _filter;
     String _username;
     String _password;
+    WebHeaderMask _headerMask;
+    WebRequestMethodComposite _methodMask;
+    uint32_t _pathPrefixHash;     // AsyncWebRouteIndex::segmentHash() of the path prefix, 0 for any url
+    bool _zeroCopyUpload;
 
   public:
-    AsyncWebHandler(): _username(""), _password("") {}
+    AsyncWebHandler(): _username(""), _password(""), _headerMask(HEADER_MASK_REQUEST), _methodMask(HTTP_ANY),
+      _pathPrefixHash(0), _zeroCopyUpload(false) {}
 
     /////////////////////////////////////////////////
 
@@ -621,6 +933,76 @@ class AsyncWebHandler
 
     /////////////////////////////////////////////////
 
+    // True if filter() or credentials restrict the requests taken, e.g. to a client address or an authenticated user
+    inline bool isRestricted() const
+    {
+      return _filter != NULL || _username.length();
+    }
+
+    /////////////////////////////////////////////////
+
+    // Methods the handler can take, requests with other methods being rejected before filter() and canHandle()
+    inline AsyncWebHandler& setMethodMask(WebRequestMethodComposite methods)
+    {
+      _methodMask = methods;
+      return *this;
+    }
+
+    /////////////////////////////////////////////////
+
+    // First url segment the handler can take, "/api" taking "/api" and "/api/...", but not "/apiv2".
+    // Requests with another one are rejected before filter() and canHandle(). "/" or NULL for any url
+    inline AsyncWebHandler& setPathPrefix(const char* prefix)
+    {
+      _pathPrefixHash = (prefix && prefix[0] && (prefix[0] != '/' || prefix[1])) ? AsyncWebRouteIndex::segmentHash(prefix) : 0;
+      return *this;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Pre-filters, checked with integer compares. HTTP_UNKNOWN matches no method mask, such requests are answered
+    // with 501 without looking for a handler anyway
+    inline bool prefilter(WebRequestMethodComposite method, uint32_t segmentHash) const
+    {
+      return ((method & _methodMask) != 0) && (_pathPrefixHash == 0 || _pathPrefixHash == segmentHash);
+    }
+
+    /////////////////////////////////////////////////
+
+    // Request headers used by this handler, e.g. webHeaderMask(HEADER_HOST, HEADER_COOKIE), HEADER_MASK_REQUEST
+    // by default. Headers no handler is interested in aren't stored. Set before AsyncWebServer::begin()
+    inline AsyncWebHandler& setInterestingHeaders(WebHeaderMask mask)
+    {
+      _headerMask = mask;
+      return *this;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline WebHeaderMask interestingHeaders() const
+    {
+      return _headerMask;
+    }
+
+    /////////////////////////////////////////////////
+
+    // Pass upload data straight from the received segment instead of in 1460 bytes chunks copied to a buffer.
+    // Data is only valid during the call, chunks can have any size and the final call may have no data
+    inline AsyncWebHandler& setZeroCopyUpload(bool enable)
+    {
+      _zeroCopyUpload = enable;
+      return *this;
+    }
+
+    /////////////////////////////////////////////////
+
+    inline bool zeroCopyUpload() const
+    {
+      return _zeroCopyUpload;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual ~AsyncWebHandler() {}
 
     /////////////////////////////////////////////////
@@ -642,6 +1024,17 @@ class AsyncWebHandler
 
     /////////////////////////////////////////////////
 
+    // Flow controlled handleBody(), returning how many bytes of data were consumed. The rest is held back, without
+    // acknowledging it to the peer, and offered again by request->resumeBody() or on the next poll
+    virtual size_t handleBodyStream(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+    {
+      handleBody(request, data, len, index, total);
+
+      return len;
+    }
+
+    /////////////////////////////////////////////////
+
     virtual bool isRequestHandlerTrivial()
     {
       return true;
@@ -664,6 +1057,9 @@ typedef enum
 
 class AsyncWebServerResponse
 {
+    friend class AsyncWebServerRequest;
+    friend class AsyncWebResponseCache;
+
   protected:
     int _code;
     LinkedList<AsyncWebHeader *> _headers;
@@ -671,12 +1067,19 @@ class AsyncWebServerResponse
     size_t _contentLength;
     bool _sendContentLength;
     bool _chunked;
+    bool _acceptRanges;         // a Range of the content can be sent, with "Accept-Ranges: bytes"
+    const char* _staticHeaders;
     size_t _headLength;
     size_t _sentLength;
     size_t _ackedLength;
     size_t _writtenLength;
     WebResponseState _state;
-    const char* _responseCodeToString(int code);
+    bool _keepAlive;
+    uint32_t _cacheTTL;         // ms the response is kept in the response cache, 0 if not cacheable
+    // Room for the status line of any int code without reason phrase
+    typedef char StatusLineBuffer[sizeof("-2147483648 \r\n")];
+    static const char* _statusLine(int code, StatusLineBuffer& buf, size_t& len);
+    void _addConnectionHeader(AsyncWebServerRequest *request);
 
   public:
     AsyncWebServerResponse();
@@ -685,11 +1088,21 @@ class AsyncWebServerResponse
     virtual void setContentLength(size_t len);
     virtual void setContentType(const String& type);
     virtual void addHeader(const String& name, const String& value);
+
+    // Keep the response in the server's response cache, answering the next GET requests of the same url for ttl ms
+    // without calling their handler. Only for 200 responses with a Content-Length, depending on nothing but the url
+    void setCacheable(uint32_t ttl);
+
+    size_t _headSize(uint8_t version) const;
     virtual String _assembleHead(uint8_t version);
     virtual bool _started() const;
     virtual bool _finished() const;
     virtual bool _failed() const;
     virtual bool _sourceValid() const;
+
+    // Copy the whole content to data for the response cache, false if it isn't available ahead of sending
+    virtual bool _renderContent(uint8_t *data, size_t len);
+
     virtual void _respond(AsyncWebServerRequest *request);
     virtual size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 };
@@ -706,17 +1119,135 @@ typedef std::function<void(AsyncWebServerRequest *request, /*const String& filen
 ArUploadHandlerFunction;
 typedef std::function<void(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)>
 ArBodyHandlerFunction;
+typedef std::function<size_t(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)>
+ArBodyStreamHandlerFunction;
+
+typedef void (*ArRequestHandlerPointer)(AsyncWebServerRequest *request);
+
+/////////////////////////////////////////////////////////
+
+// Entry of a constexpr route table, see AsyncWebServer::addRoutes()
+struct AsyncWebRoute
+{
+  const char*               path;       // url path, matched exactly, or with "{name}" segments
+  WebRequestMethodComposite methods;
+  ArRequestHandlerPointer   handler;
+};
+
+/////////////////////////////////////////////////////////
+
+// One MSS sized buffer shared by all the connections, bounding the heap used to fill responses. It is borrowed and
+// given back within one ack or poll, the data being copied by lwIP when queued, and callbacks never run concurrently
+class AsyncWebSendBuffer
+{
+  private:
+    uint8_t _buffer[ASYNCWEBSERVER_SEND_BUFFER_SIZE];
+    bool _lent;
+
+  public:
+    AsyncWebSendBuffer();
+
+    // ASYNCWEBSERVER_SEND_BUFFER_SIZE bytes, NULL if already lent
+    uint8_t* borrow();
+    void giveBack(uint8_t* buffer);
+
+    /////////////////////////////////////////////////
+
+    static constexpr size_t size()
+    {
+      return ASYNCWEBSERVER_SEND_BUFFER_SIZE;
+    }
+};
+
+/////////////////////////////////////////////////////////
+
+// Responses marked with setCacheable(), kept whole in an arena of ASYNCWEBSERVER_RESPONSE_CACHE_SIZE bytes: the url,
+// the head without its Connection line, then the body. Looked up ahead of the other handlers, it answers the GET
+// requests of a cached url until the TTL elapses, without running their handler
+class AsyncWebResponseCache: public AsyncWebHandler
+{
+    friend class AsyncCachedResponse;
+
+  private:
+    struct Entry
+    {
+      size_t   offset;          // in _arena
+      size_t   urlLength;
+      size_t   headLength;
+      size_t   bodyLength;
+      uint32_t expires;         // millis()
+      uint32_t lastUse;
+      uint8_t  pins;            // AsyncCachedResponse sending from the entry, which is kept meanwhile
+      bool     used;
+      bool     stale;           // replaced or cleared while sent, dropped once unpinned
+    };
+
+    uint8_t* _arena;
+    Entry _entries[ASYNCWEBSERVER_RESPONSE_CACHE_ENTRIES];
+    uint32_t _uses;
+
+    static bool _cacheable(AsyncWebServerRequest *request);
+    int _find(const String& url, bool fresh);
+    int _makeRoom(size_t len);
+    void _compact();
+    void _release(int entry);
+
+    /////////////////////////////////////////////////
+
+    static inline size_t _size(const Entry& entry)
+    {
+      return entry.urlLength + 1 + entry.headLength + entry.bodyLength;
+    }
+
+    /////////////////////////////////////////////////
+
+  public:
+    AsyncWebResponseCache();
+    ~AsyncWebResponseCache();
+
+    // Render a response marked with setCacheable() into the cache. Returns the response sending it from there,
+    // NULL if it can't be cached, the response being then sent as is
+    AsyncWebServerResponse* store(AsyncWebServerRequest *request, AsyncWebServerResponse *response);
+
+    void clear();
+
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+};
 
 /////////////////////////////////////////////////////////
 
 class AsyncWebServer
 {
+    friend class AsyncWebServerRequest;
+
   protected:
     AsyncServer _server;
     LinkedList<AsyncWebRewrite*> _rewrites;
     LinkedList<AsyncWebHandler*> _handlers;
     AsyncCallbackWebHandler* _catchAllHandler;
 
+    // Finds the handler of each request, handlers added with on() being looked up by uri
+    AsyncWebRouteIndex _routes;
+
+    // Finds the rewrites of each request, the ones added with rewrite() being looked up by hash
+    AsyncWebRewriteIndex _rewriteIndex;
+
+    bool _keepAlive;
+    uint16_t _keepAliveMaxRequests;
+    uint16_t _keepAliveTimeout;
+
+    // Union of the interesting headers of all handlers, checked while parsing
+    WebHeaderMask _headerMask;
+
+    AsyncWebSendBuffer _sendBuffer;
+
+    // Responses marked with setCacheable(), answering requests before the handlers
+    AsyncWebResponseCache _responseCache;
+
+    void _updateHeaderMask();
+    AsyncCallbackWebHandler& _addRoute(AsyncCallbackWebHandler* handler, const char* uri);
+
   public:
     AsyncWebServer(uint16_t port);
     ~AsyncWebServer();
@@ -724,6 +1255,10 @@ class AsyncWebServer
     void begin();
     void end();
 
+    // Serve up to maxRequests requests per connection, closing it after timeout seconds without a new request
+    void setKeepAlive(bool enable, uint16_t maxRequests = ASYNCWEBSERVER_KEEPALIVE_MAX_REQUESTS,
+                      uint16_t timeout = ASYNCWEBSERVER_KEEPALIVE_TIMEOUT);
+
 #if ASYNC_TCP_SSL_ENABLED
     //void onSslFileRequest(AcSSlFileHandler cb, void* arg);
     //void beginSecure(const char *cert, const char *private_key_file, const char *password);
@@ -736,6 +1271,20 @@ class AsyncWebServer
     AsyncWebHandler& addHandler(AsyncWebHandler* handler);
     bool removeHandler(AsyncWebHandler* handler);
 
+    // Serve the files of a ROM filesystem below uri
+    AsyncRomWebHandler& serveStatic(const char* uri, const AsyncWebRomFS& fs, const char* cache_control = NULL);
+
+    // Routes of a constexpr table used straight from flash, one handler taking all of them, in table order.
+    // The table must outlive the server. Routes have no upload or body callbacks
+    AsyncWebHandler& addRoutes(const AsyncWebRoute* routes, size_t count);
+
+    template<size_t N>
+    inline AsyncWebHandler& addRoutes(const AsyncWebRoute (&routes)[N])
+    {
+      return addRoutes(routes, N);
+    }
+
+    // Handlers added with on() are indexed by uri, changing it later with setUri() isn't supported
     AsyncCallbackWebHandler& on(const char* uri, ArRequestHandlerFunction onRequest);
     AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
 
@@ -745,7 +1294,7 @@ class AsyncWebServer
     AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
                                 ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody);
 
-    void onNotFound(ArRequestHandlerFunction fn);  //called when handler is not assigned
+    AsyncCallbackWebHandler& onNotFound(ArRequestHandlerFunction fn);  //called when handler is not assigned
     void onRequestBody(ArBodyHandlerFunction
                        fn); //handle posts with plain body content (JSON often transmitted this way as a request)
 
@@ -17,7 +17,7 @@
   You should have received a copy of the GNU General Public License along with this program.
   If not, see <https://www.gnu.org/licenses/>
 
-  Version: 1.6.1
+  Version: 1.7.0
 
   Version Modified By   Date      Comments
   ------- -----------  ---------- -----------
@@ -33,6 +33,7 @@
   1.5.0   K Hoang      22/06/2022 Update for STM32 core v2.3.0
   1.6.0   K Hoang      06/10/2022 Option to use non-destroyed cString instead of String to save Heap
   1.6.1   K Hoang      11/11/2022 Add examples to demo how to use beginChunkedResponse() to send in chunks
+  1.7.0   K Hoang      17/10/2026 Add HTTP/1.1 keep-alive and request parsing / response sending performance enhancements
  *****************************************************************************************************************************/
 
 #include "Arduino.h"
@@ -1297,6 +1298,11 @@ AsyncWebSocket::AsyncWebSocket(const String & url)
 }))
 {
   _eventHandler = NULL;
+
+  setInterestingHeaders(webHeaderMask(HEADER_CONNECTION, HEADER_UPGRADE, HEADER_ORIGIN, HEADER_SEC_WEBSOCKET_VERSION,
+                                      HEADER_SEC_WEBSOCKET_KEY, HEADER_SEC_WEBSOCKET_PROTOCOL));
+  setMethodMask(HTTP_GET);
+  setPathPrefix(_url.c_str());
 }
 
 /////////////////////////////////////////////////
@@ -1718,13 +1724,6 @@ bool AsyncWebSocket::canHandle(AsyncWebServerRequest * request)
   if (request->method() != HTTP_GET || !request->url().equals(_url) || !request->isExpectedRequestedConnType(RCT_WS))
     return false;
 
-  request->addInterestingHeader(WS_STR_CONNECTION);
-  request->addInterestingHeader(WS_STR_UPGRADE);
-  request->addInterestingHeader(WS_STR_ORIGIN);
-  request->addInterestingHeader(WS_STR_VERSION);
-  request->addInterestingHeader(WS_STR_KEY);
-  request->addInterestingHeader(WS_STR_PROTOCOL);
-
   return true;
 }
 
@@ -1732,7 +1731,7 @@ bool AsyncWebSocket::canHandle(AsyncWebServerRequest * request)
 
 void AsyncWebSocket::handleRequest(AsyncWebServerRequest * request)
 {
-  if (!request->hasHeader(WS_STR_VERSION) || !request->hasHeader(WS_STR_KEY))
+  if (!request->hasHeader(HEADER_SEC_WEBSOCKET_VERSION) || !request->hasHeader(HEADER_SEC_WEBSOCKET_KEY))
   {
     request->send(400);
 
@@ -1744,7 +1743,7 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest * request)
     return request->requestAuthentication();
   }
 
-  AsyncWebHeader* version = request->getHeader(WS_STR_VERSION);
+  AsyncWebHeader* version = request->getHeader(HEADER_SEC_WEBSOCKET_VERSION);
 
   if (version->value().toInt() != 13)
   {
@@ -1755,12 +1754,12 @@ void AsyncWebSocket::handleRequest(AsyncWebServerRequest * request)
     return;
   }
 
-  AsyncWebHeader* key = request->getHeader(WS_STR_KEY);
+  AsyncWebHeader* key = request->getHeader(HEADER_SEC_WEBSOCKET_KEY);
   AsyncWebServerResponse *response = new AsyncWebSocketResponse(key->value(), this);
 
-  if (request->hasHeader(WS_STR_PROTOCOL))
+  if (request->hasHeader(HEADER_SEC_WEBSOCKET_PROTOCOL))
   {
-    AsyncWebHeader* protocol = request->getHeader(WS_STR_PROTOCOL);
+    AsyncWebHeader* protocol = request->getHeader(HEADER_SEC_WEBSOCKET_PROTOCOL);
     //ToDo: check protocol
     response->addHeader(WS_STR_PROTOCOL, protocol->value());
   }
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+#
+# romfs_gen.py - Generate a ROM filesystem header for AsyncWebServer_STM32
+#
+# Turns the files of a directory into a constexpr AsyncWebRomFS table compiled into flash,
+# served with server.serveStatic(uri, fs). Files ending with ".gz" are served without the
+# extension and with "Content-Encoding: gzip". A file present both plain and gzipped (e.g.
+# "app.js" and "app.js.gz", or with --gzip --keep-plain) keeps both variants: the gzipped one
+# goes to clients sending "Accept-Encoding: gzip", the plain one to the others
+#
+# Usage: python3 utils/romfs_gen.py [--name romfs] [--gzip [--keep-plain]] <data dir> <output header>
+#
+#   python3 utils/romfs_gen.py examples/AsyncFSBrowser_STM32/data examples/AsyncFSBrowser_STM32/romfs.h
+#
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+CONTENT_TYPES = {
+  ".htm"  : "text/html",
+  ".html" : "text/html",
+  ".css"  : "text/css",
+  ".js"   : "application/javascript",
+  ".json" : "application/json",
+  ".txt"  : "text/plain",
+  ".xml"  : "text/xml",
+  ".png"  : "image/png",
+  ".gif"  : "image/gif",
+  ".jpg"  : "image/jpeg",
+  ".jpeg" : "image/jpeg",
+  ".ico"  : "image/x-icon",
+  ".svg"  : "image/svg+xml",
+  ".eot"  : "font/eot",
+  ".woff" : "font/woff",
+  ".woff2": "font/woff2",
+  ".ttf"  : "font/ttf",
+  ".pdf"  : "application/pdf",
+  ".zip"  : "application/zip",
+}
+
+# Types worth compressing with --gzip
+COMPRESSIBLE = ("text/", "application/javascript", "application/json", "image/svg+xml")
+
+BYTES_PER_LINE = 16
+
+
+def content_type(path):
+  return CONTENT_TYPES.get(os.path.splitext(path)[1].lower(), "application/octet-stream")
+
+
+def c_string(text):
+  return '"' + text.replace("\\", "\\\\").replace('"', '\\"').replace("\r", "\\r").replace("\n", "\\n") + '"'
+
+
+def collect(data_dir, compress, keep_plain):
+  files = {}
+
+  def add(path, data, is_gzip):
+    if (path, is_gzip) in files:
+      sys.exit("romfs_gen: %s exists twice %s" % (path, "gzipped" if is_gzip else "plain"))
+
+    files[(path, is_gzip)] = data
+
+  for root, _, names in os.walk(data_dir):
+    for name in names:
+      full = os.path.join(root, name)
+      path = "/" + os.path.relpath(full, data_dir).replace(os.sep, "/")
+
+      with open(full, "rb") as f:
+        data = f.read()
+
+      if path.endswith(".gz"):
+        add(path[:-3], data, True)
+        continue
+
+      if compress and content_type(path).startswith(COMPRESSIBLE):
+        packed = gzip.compress(data, 9, mtime=0)
+
+        if len(packed) < len(data):
+          add(path, packed, True)
+
+          if not keep_plain:
+            continue
+
+      add(path, data, False)
+
+  # Sorted by the bytes of the path, as compared by AsyncWebRomFS::find(), the plain variant first
+  return [(path, files[(path, is_gzip)], is_gzip, (path, not is_gzip) in files)
+          for path, is_gzip in sorted(files, key=lambda key: (key[0].encode("utf-8"), key[1]))]
+
+
+def generate(files, name, data_dir):
+  out = []
+  out.append("// Generated by utils/romfs_gen.py from %s, don't edit" % data_dir)
+  out.append("")
+  out.append("#pragma once")
+  out.append("")
+  out.append("#include <AsyncWebServer_STM32.h>")
+  out.append("")
+
+  entries = []
+
+  for index, (path, data, is_gzip, negotiated) in enumerate(files):
+    symbol = "%s_data_%d" % (name, index)
+    ctype = content_type(path)
+    etag = '"%s"' % hashlib.sha1(data).hexdigest()[:16]
+
+    headers = "Content-Type: %s\r\n" % ctype
+
+    if is_gzip:
+      headers += "Content-Encoding: gzip\r\n"
+
+    # The response depends on Accept-Encoding when both variants exist
+    if negotiated:
+      headers += "Vary: Accept-Encoding\r\n"
+
+    headers += "ETag: %s\r\n" % etag
+
+    out.append("// %s, %d bytes%s" % (path, len(data), ", gzip" if is_gzip else ""))
+    out.append("static const uint8_t %s[] PROGMEM =" % symbol)
+    out.append("{")
+
+    for i in range(0, len(data), BYTES_PER_LINE):
+      out.append("  " + ", ".join("0x%02x" % b for b in data[i:i + BYTES_PER_LINE]) + ",")
+
+    out.append("};")
+    out.append("")
+
+    entries.append("  { %s, %s, %d, %s, %s, %s, %s }," % (c_string(path), symbol, len(data), c_string(ctype),
+                   c_string(etag), c_string(headers), "true" if is_gzip else "false"))
+
+  out.append("static constexpr AsyncWebRomFile %s_files[] =" % name)
+  out.append("{")
+  out.extend(entries)
+  out.append("};")
+  out.append("")
+  out.append("static constexpr AsyncWebRomFS %s = { %s_files, sizeof(%s_files) / sizeof(%s_files[0]) };" % (name, name, name, name))
+  out.append("")
+
+  return "\n".join(out)
+
+
+def main():
+  parser = argparse.ArgumentParser(description="Generate an AsyncWebServer_STM32 ROM filesystem header")
+  parser.add_argument("--name", default="romfs", help="C identifier of the generated AsyncWebRomFS (default romfs)")
+  parser.add_argument("--gzip", action="store_true", help="gzip compressible files when it makes them smaller")
+  parser.add_argument("--keep-plain", action="store_true",
+                      help="with --gzip, also keep the plain variant for clients not accepting gzip")
+  parser.add_argument("data_dir")
+  parser.add_argument("output")
+  args = parser.parse_args()
+
+  if not re.match(r"^[A-Za-z_][A-Za-z0-9_]*$", args.name):
+    sys.exit("romfs_gen: invalid name %s" % args.name)
+
+  if args.keep_plain and not args.gzip:
+    sys.exit("romfs_gen: --keep-plain needs --gzip")
+
+  files = collect(args.data_dir, args.gzip, args.keep_plain)
+
+  if not files:
+    sys.exit("romfs_gen: no files in %s" % args.data_dir)
+
+  with open(args.output, "w") as f:
+    f.write(generate(files, args.name, args.data_dir))
+
+  print("romfs_gen: %d files written to %s" % (len(files), args.output))
+
+
+if __name__ == "__main__":
+  main()